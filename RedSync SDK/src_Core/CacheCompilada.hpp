@@ -0,0 +1,234 @@
+#ifndef CACHE_COMPILADA_HPP
+#define CACHE_COMPILADA_HPP
+
+#include "RedCodeCore.hpp"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// --- CACHÉ DE SCRIPTS COMPILADOS (.redc) ---
+// Guarda junto al .red la forma ya compilada (instrucciones normalizadas con su
+// línea real, tabla de saltos y tabla de funciones). Solo es válida si la
+// generó este mismo binario del intérprete (sello de compilación), con el
+// mismo nivel -O, y si el hash y el tamaño del fuente coinciden; en otro caso
+// se ignora y se recompila. Al cargarla se comprueba además que los saltos y
+// los inicios de función caen dentro del script: un .redc dañado cuenta como
+// fallo, nunca se ejecuta. La validación del script (funciones puras,
+// cada_paralelo) la hizo el mismo binario al generarla.
+//
+// Formato (binario, orden de bytes de la máquina):
+//   "REDC" | u32 version | u64 sello | u32 nivel -O | u64 hash | u64 tamaño fuente
+//   u32 n  | n x (u32 linea_origen, u32 largo, bytes)
+//   u32 n  | n x (i32 origen, i32 destino)
+//   u32 n  | n x (u32 largo, nombre, i32 linea_inicio, u8 pura, u32 n_params, n_params x (u32 largo, bytes))
+
+class CacheCompilada {
+public:
+    // Sube cuando cambia el formato o lo que produce el compilador/optimizador
+    static const uint32_t VERSION = 4;
+
+    // Distinto en cada compilación del intérprete: un cambio del compilador o
+    // del optimizador invalida las cachés aunque VERSION no cambie
+    static uint64_t sello() {
+        static const uint64_t s = hash_fuente(__DATE__ " " __TIME__ " " + to_string(VERSION));
+        return s;
+    }
+
+    // "calculo.red" -> "calculo.redc"
+    static string ruta_para(const string& ruta_red) {
+        if (ruta_red.size() >= 4 && ruta_red.compare(ruta_red.size() - 4, 4, ".red") == 0) return ruta_red + "c";
+        return ruta_red + ".redc";
+    }
+
+    // Se escribe en un temporal y se renombra encima: otra ejecución que lea la
+    // caché a la vez ve la versión anterior completa o la nueva, nunca media.
+    static bool guardar(const string& ruta, const string& fuente, const ProgramaCompilado& prog) {
+        string buf;
+        buf.append("REDC", 4);
+        poner<uint32_t>(buf, VERSION);
+        poner<uint64_t>(buf, sello());
+        poner<uint32_t>(buf, (uint32_t)nivel_optimizacion);
+        poner<uint64_t>(buf, hash_fuente(fuente));
+        poner<uint64_t>(buf, (uint64_t)fuente.size());
+
+        poner<uint32_t>(buf, (uint32_t)prog.script.size());
+        for (size_t i = 0; i < prog.script.size(); i++) {
+            poner<uint32_t>(buf, (uint32_t)prog.lineas_origen[i]);
+            poner_texto(buf, prog.script[i]);
+        }
+        poner<uint32_t>(buf, (uint32_t)prog.saltos.size());
+        for (const auto& s : prog.saltos) {
+            poner<int32_t>(buf, s.first);
+            poner<int32_t>(buf, s.second);
+        }
+        poner<uint32_t>(buf, (uint32_t)prog.funciones.size());
+        for (const auto& f : prog.funciones) {
+            poner_texto(buf, f.first);
+            poner<int32_t>(buf, f.second.linea_inicio);
+            poner<uint8_t>(buf, f.second.pura ? 1 : 0);
+            poner<uint32_t>(buf, (uint32_t)f.second.parametros.size());
+            for (const auto& p : f.second.parametros) poner_texto(buf, p);
+        }
+
+#ifdef _WIN32
+        string temporal = ruta + "." + to_string(_getpid()) + ".tmp";
+#else
+        string temporal = ruta + "." + to_string(getpid()) + ".tmp";
+#endif
+        {
+            ofstream salida(temporal, ios::binary | ios::trunc);
+            if (!salida.is_open()) return false;
+            salida.write(buf.data(), (streamsize)buf.size());
+            salida.close();
+            if (!salida) { remove(temporal.c_str()); return false; }
+        }
+#ifdef _WIN32
+        bool ok = MoveFileExA(temporal.c_str(), ruta.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        bool ok = rename(temporal.c_str(), ruta.c_str()) == 0;
+#endif
+        if (!ok) remove(temporal.c_str());
+        return ok;
+    }
+
+    // true si la caché existe, corresponde a 'fuente' y se pudo leer entera
+    static bool cargar(const string& ruta, const string& fuente, ProgramaCompilado& prog) {
+        ArchivoMapeado mapa(ruta);
+        if (!mapa.datos) return false;
+
+        Lector r{mapa.datos, mapa.datos + mapa.tamano};
+        if (!r.hay(4) || memcmp(r.p, "REDC", 4) != 0) return false;
+        r.p += 4;
+
+        uint32_t version, nivel; uint64_t marca, hash, tam;
+        if (!r.leer(version) || version != VERSION) return false;
+        if (!r.leer(marca) || marca != sello()) return false;
+        if (!r.leer(nivel) || nivel != (uint32_t)nivel_optimizacion) return false;
+        if (!r.leer(hash) || hash != hash_fuente(fuente)) return false;
+        if (!r.leer(tam) || tam != (uint64_t)fuente.size()) return false;
+
+        ProgramaCompilado nuevo;
+        uint32_t n;
+        if (!r.leer(n)) return false;
+        nuevo.script.reserve(n);
+        nuevo.lineas_origen.reserve(n);
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t linea; string instr;
+            if (!r.leer(linea) || !r.leer_texto(instr)) return false;
+            nuevo.lineas_origen.push_back((int)linea);
+            nuevo.script.push_back(move(instr));
+        }
+        if (!r.leer(n)) return false;
+        int32_t lineas = (int32_t)nuevo.script.size();
+        for (uint32_t i = 0; i < n; i++) {
+            int32_t origen, destino;
+            if (!r.leer(origen) || !r.leer(destino)) return false;
+            if (origen < 0 || origen >= lineas || destino < 0 || destino > lineas) return false;
+            nuevo.saltos.emplace_hint(nuevo.saltos.end(), origen, destino);
+        }
+        if (!r.leer(n)) return false;
+        for (uint32_t i = 0; i < n; i++) {
+            string nombre; int32_t inicio; uint8_t pura; uint32_t np;
+            if (!r.leer_texto(nombre) || !r.leer(inicio) || !r.leer(pura) || !r.leer(np)) return false;
+            if (inicio < 1 || inicio > lineas) return false; // la línea anterior es 'funcion'
+            InfoFuncion info;
+            info.linea_inicio = inicio;
+            info.pura = pura != 0;
+            for (uint32_t k = 0; k < np; k++) {
+                string p;
+                if (!r.leer_texto(p)) return false;
+                info.parametros.push_back(move(p));
+            }
+            nuevo.funciones[nombre] = move(info);
+        }
+
+        prog = move(nuevo);
+        return true;
+    }
+
+private:
+    template <typename T>
+    static void poner(string& buf, T v) { buf.append(reinterpret_cast<const char*>(&v), sizeof(T)); }
+
+    static void poner_texto(string& buf, const string& t) {
+        poner<uint32_t>(buf, (uint32_t)t.size());
+        buf.append(t);
+    }
+
+    struct Lector {
+        const char* p;
+        const char* fin;
+        bool hay(size_t n) const { return (size_t)(fin - p) >= n; }
+        template <typename T>
+        bool leer(T& v) {
+            if (!hay(sizeof(T))) return false;
+            memcpy(&v, p, sizeof(T));
+            p += sizeof(T);
+            return true;
+        }
+        bool leer_texto(string& t) {
+            uint32_t n;
+            if (!leer(n) || !hay(n)) return false;
+            t.assign(p, n);
+            p += n;
+            return true;
+        }
+    };
+
+    // El archivo entero se proyecta en memoria de una sola vez
+    struct ArchivoMapeado {
+        const char* datos = nullptr;
+        size_t tamano = 0;
+#ifdef _WIN32
+        HANDLE archivo = INVALID_HANDLE_VALUE, vista = NULL;
+        explicit ArchivoMapeado(const string& ruta) {
+            archivo = CreateFileA(ruta.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (archivo == INVALID_HANDLE_VALUE) return;
+            LARGE_INTEGER tam;
+            if (!GetFileSizeEx(archivo, &tam) || tam.QuadPart == 0) return;
+            vista = CreateFileMappingA(archivo, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (!vista) return;
+            datos = (const char*)MapViewOfFile(vista, FILE_MAP_READ, 0, 0, 0);
+            if (datos) tamano = (size_t)tam.QuadPart;
+        }
+        ~ArchivoMapeado() {
+            if (datos) UnmapViewOfFile(datos);
+            if (vista) CloseHandle(vista);
+            if (archivo != INVALID_HANDLE_VALUE) CloseHandle(archivo);
+        }
+#else
+        explicit ArchivoMapeado(const string& ruta) {
+            int fd = open(ruta.c_str(), O_RDONLY);
+            if (fd < 0) return;
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                void* m = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (m != MAP_FAILED) { datos = (const char*)m; tamano = (size_t)st.st_size; }
+            }
+            close(fd);
+        }
+        ~ArchivoMapeado() {
+            if (datos) munmap((void*)datos, tamano);
+        }
+#endif
+        ArchivoMapeado(const ArchivoMapeado&) = delete;
+        ArchivoMapeado& operator=(const ArchivoMapeado&) = delete;
+    };
+};
+
+#endif
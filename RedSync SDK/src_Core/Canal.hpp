@@ -0,0 +1,163 @@
+#ifndef CANAL_HPP
+#define CANAL_HPP
+
+#include <atomic>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// --- CANAL ENTRE HILOS ---
+// Cola acotada de varios productores y varios consumidores (la de Dmitry
+// Vyukov): cada casilla lleva un número de secuencia que dice si está libre
+// para la vuelta actual del productor o lista para la del consumidor, así que
+// enviar y recibir solo hacen un compare_exchange sobre su índice y no toman
+// cerrojos mientras haya sitio o mensajes.
+//
+// Cuando la cola está llena (o vacía) el hilo gira un poco y después duerme en
+// una variable de condición; quien cambia el estado solo toma el cerrojo para
+// despertarlo si hay alguien durmiendo. Así la capacidad frena a la etapa
+// rápida de un pipeline sin gastar CPU. Quien duerme se despierta cada
+// REVISION para llamar a 'revisar' (los límites de la ejecución), que puede
+// lanzar una excepción y sacarlo de la espera.
+
+struct Mensaje {
+    double n = 0.0;
+    string t;
+    bool es_texto = false;
+};
+
+class Canal {
+public:
+    static constexpr chrono::milliseconds REVISION{50};
+
+    // La capacidad se redondea a la siguiente potencia de 2 (mínimo 2)
+    explicit Canal(size_t capacidad, void (*revisar)() = nullptr) : revisar(revisar) {
+        size_t cap = 2;
+        while (cap < capacidad) cap <<= 1;
+        casillas = vector<Casilla>(cap);
+        mascara = cap - 1;
+        for (size_t i = 0; i < cap; i++) casillas[i].secuencia.store(i, memory_order_relaxed);
+    }
+
+    size_t capacidad() const { return mascara + 1; }
+
+    // false si el canal está cerrado (el mensaje no se envía)
+    bool enviar(Mensaje m) {
+        bool ok = false;
+        esperar_a([&] { return cerrado.load(memory_order_acquire) || (ok = intentar_enviar(m)); });
+        if (ok) avisar();
+        return ok;
+    }
+
+    // false si el canal está cerrado y ya no le quedan mensajes
+    bool recibir(Mensaje& m) {
+        bool ok = false;
+        esperar_a([&] {
+            if ((ok = intentar_recibir(m))) return true;
+            if (!cerrado.load(memory_order_acquire)) return false;
+            // Cerrado: lo enviado antes de cerrar todavía se entrega
+            ok = intentar_recibir(m);
+            return true;
+        });
+        if (ok) avisar();
+        return ok;
+    }
+
+    void cerrar() {
+        cerrado.store(true, memory_order_release);
+        avisar();
+    }
+
+private:
+    struct Casilla {
+        atomic<size_t> secuencia{0};
+        Mensaje valor;
+    };
+
+    vector<Casilla> casillas;
+    size_t mascara = 0;
+    void (*revisar)();
+    alignas(64) atomic<size_t> pos_envio{0};
+    alignas(64) atomic<size_t> pos_recepcion{0};
+    alignas(64) atomic<bool> cerrado{false};
+    atomic<int> durmiendo{0};
+    mutex m;
+    condition_variable cv;
+
+    bool intentar_enviar(Mensaje& msg) {
+        size_t pos = pos_envio.load(memory_order_relaxed);
+        Casilla* c;
+        for (;;) {
+            c = &casillas[pos & mascara];
+            size_t sec = c->secuencia.load(memory_order_acquire);
+            intptr_t dif = (intptr_t)sec - (intptr_t)pos;
+            if (dif == 0) {
+                if (pos_envio.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+            }
+            else if (dif < 0) return false; // llena
+            else pos = pos_envio.load(memory_order_relaxed);
+        }
+        c->valor = move(msg);
+        c->secuencia.store(pos + 1, memory_order_release);
+        return true;
+    }
+
+    bool intentar_recibir(Mensaje& msg) {
+        size_t pos = pos_recepcion.load(memory_order_relaxed);
+        Casilla* c;
+        for (;;) {
+            c = &casillas[pos & mascara];
+            size_t sec = c->secuencia.load(memory_order_acquire);
+            intptr_t dif = (intptr_t)sec - (intptr_t)(pos + 1);
+            if (dif == 0) {
+                if (pos_recepcion.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+            }
+            else if (dif < 0) return false; // vacía
+            else pos = pos_recepcion.load(memory_order_relaxed);
+        }
+        msg = move(c->valor);
+        c->secuencia.store(pos + mascara + 1, memory_order_release);
+        return true;
+    }
+
+    // Despierta a los que duermen. La barrera empareja con la de esperar_a: o
+    // el que se va a dormir ve el cambio al reintentar, o aquí se le ve a él.
+    void avisar() {
+        atomic_thread_fence(memory_order_seq_cst);
+        if (durmiendo.load(memory_order_relaxed) == 0) return;
+        lock_guard<mutex> lk(m);
+        cv.notify_all();
+    }
+
+    // Repite 'listo' hasta que devuelva true: primero girando, después
+    // durmiendo hasta que otro hilo envíe, reciba o cierre.
+    template <typename F>
+    void esperar_a(F listo) {
+        for (int i = 0; i < 64; i++) {
+            if (listo()) return;
+            if (i >= 16) this_thread::yield();
+        }
+        unique_lock<mutex> lk(m);
+        durmiendo.fetch_add(1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        struct Despierto {
+            atomic<int>& d;
+            ~Despierto() { d.fetch_sub(1, memory_order_relaxed); }
+        } despierto{durmiendo};
+        while (!cv.wait_for(lk, REVISION, listo)) {
+            if (!revisar) continue;
+            lk.unlock();
+            revisar();
+            lk.lock();
+        }
+    }
+};
+
+#endif
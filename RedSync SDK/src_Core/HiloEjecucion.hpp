@@ -0,0 +1,132 @@
+#ifndef HILO_EJECUCION_HPP
+#define HILO_EJECUCION_HPP
+
+#include <functional>
+#include <exception>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+using namespace std;
+
+// --- HILO DE EJECUCIÓN CON PILA GRANDE ---
+// Cada llamada a una función del script anida varias funciones del intérprete
+// (invocar_funcion_generica -> ejecutar_bloque -> evaluar_matematica -> ...),
+// así que la recursión del script consume pila nativa. El programa se ejecuta
+// en un hilo propio cuya pila se reserva a medida de --profundidad-max; el
+// sistema solo compromete las páginas que de verdad se tocan. Las tareas, los
+// hilos del script y los trabajadores de cada_paralelo tienen una pila más
+// pequeña y un límite de profundidad propio, PROFUNDIDAD_AUXILIAR.
+
+class HiloEjecucion {
+    struct Paquete {
+        const function<void()>* tarea;
+        exception_ptr error;
+    };
+
+public:
+    static const int PROFUNDIDAD_AUXILIAR = 1000;
+
+    // Pila nativa para 'profundidad' llamadas anidadas del script
+    static size_t bytes_para(int profundidad) {
+        const double BYTES_POR_LLAMADA = 16 * 1024; // un nivel de recursión, con margen
+        double bytes = 8.0 * 1024 * 1024 + profundidad * BYTES_POR_LLAMADA;
+        if (bytes > (double)(SIZE_MAX / 2)) bytes = (double)(SIZE_MAX / 2);
+        return (size_t)bytes;
+    }
+
+    // Ejecuta 'tarea' en un hilo con 'bytes_pila' de pila y espera a que acabe.
+    // Una excepción de la tarea se relanza en el hilo que llama.
+    static void ejecutar(size_t bytes_pila, const function<void()>& tarea) {
+        Paquete p{&tarea, nullptr};
+#ifdef _WIN32
+        HANDLE h = CreateThread(NULL, bytes_pila, entrada, &p, STACK_SIZE_PARAM_IS_A_RESERVATION, NULL);
+        if (!h) { tarea(); return; } // sin hilo se ejecuta aquí, con la pila normal
+        WaitForSingleObject(h, INFINITE);
+        CloseHandle(h);
+#else
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setstacksize(&attr, bytes_pila);
+        pthread_t hilo;
+        bool creado = pthread_create(&hilo, &attr, entrada, &p) == 0;
+        pthread_attr_destroy(&attr);
+        if (!creado) { tarea(); return; }
+        pthread_join(hilo, nullptr);
+#endif
+        if (p.error) rethrow_exception(p.error);
+    }
+
+    // Como ejecutar(), pero sin esperar: el hilo arranca al construirlo y
+    // unir() espera a que acabe y relanza su excepción. Si el sistema no puede
+    // crear el hilo la tarea no se ejecuta; quien lo construye mira iniciado().
+    // No se copia ni se mueve (el hilo usa su dirección).
+    class Lanzado {
+    public:
+        Lanzado(size_t bytes_pila, function<void()> t) : tarea(move(t)) {
+            p.tarea = &tarea;
+#ifdef _WIN32
+            h = CreateThread(NULL, bytes_pila, entrada, &p, STACK_SIZE_PARAM_IS_A_RESERVATION, NULL);
+            creado = h != NULL;
+#else
+            pthread_attr_t attr;
+            pthread_attr_init(&attr);
+            pthread_attr_setstacksize(&attr, bytes_pila);
+            creado = pthread_create(&hilo, &attr, entrada, &p) == 0;
+            pthread_attr_destroy(&attr);
+#endif
+        }
+        ~Lanzado() {
+            try { unir(); } catch (...) {}
+        }
+        Lanzado(const Lanzado&) = delete;
+        Lanzado& operator=(const Lanzado&) = delete;
+
+        bool iniciado() const { return creado; }
+
+        void unir() {
+            if (unido) return;
+            unido = true;
+            if (creado) {
+#ifdef _WIN32
+                WaitForSingleObject(h, INFINITE);
+                CloseHandle(h);
+#else
+                pthread_join(hilo, nullptr);
+#endif
+            }
+            if (p.error) rethrow_exception(p.error);
+        }
+
+    private:
+        function<void()> tarea;
+        Paquete p{nullptr, nullptr};
+        bool creado = false;
+        bool unido = false;
+#ifdef _WIN32
+        HANDLE h = NULL;
+#else
+        pthread_t hilo;
+#endif
+    };
+
+private:
+    static void correr(void* datos) {
+        Paquete* p = (Paquete*)datos;
+        try { (*p->tarea)(); }
+        catch (...) { p->error = current_exception(); }
+    }
+
+#ifdef _WIN32
+    static DWORD WINAPI entrada(LPVOID datos) { correr(datos); return 0; }
+#else
+    static void* entrada(void* datos) { correr(datos); return nullptr; }
+#endif
+};
+
+#endif
@@ -0,0 +1,298 @@
+#ifndef INSTRUCCIONES_HPP
+#define INSTRUCCIONES_HPP
+
+#include "RedCodeCore.hpp"
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <algorithm>
+#include <cstdint>
+#include <cctype>
+#include <cstdlib>
+#include <iomanip>
+
+using namespace std;
+
+// --- INSTRUCCIONES DECODIFICADAS ---
+// Al activar un programa cada línea se analiza una vez y queda como una
+// Instruccion: un código de operación, los saltos ya resueltos y los operandos
+// ya separados. ejecutar_desde salta de una operación a la siguiente con goto
+// calculado (un salto indirecto por operación, que el procesador predice por
+// separado para cada una) o, sin soporte del compilador, con un switch.
+//
+// Las operaciones rápidas son superinstrucciones para las formas que más se
+// repiten en los bucles (ver --frecuencia-ops):
+//   si/mientras (a < b)      compara y salta, sin pasar por el evaluador
+//   contar!                  incrementa, compara con el límite y vuelve al cuerpo
+//   x = a + b, vn x = a * 2  aritmética de dos operandos sobre variables vn
+//   cada (l en entrada_lineas), cada (f en entrada_csv(","))
+//                            lee el registro y entra, o sale, sin volver a
+//                            analizar la cabecera
+// Un operando es un nombre o un número sin signo. Si en la ejecución algo no
+// encaja (la variable es de texto, no existe, es una lista...) la línea se
+// ejecuta por el camino general, que da siempre el resultado de referencia.
+// El resto de operaciones solo sirven para contar frecuencias y van al camino
+// general.
+
+enum Operacion : uint8_t {
+    OP_GENERICA,
+    OP_SI,
+    OP_MIENTRAS,
+    OP_SI_COMPARA,
+    OP_MIENTRAS_COMPARA,
+    OP_SINO,
+    OP_FIN_SI,
+    OP_FIN_MIENTRAS,
+    OP_CONTAR,
+    OP_FIN_CONTAR,
+    OP_FUNCION,
+    OP_FIN_FUNCION,
+    OP_ASIGNA_ARITMETICA,
+    OP_ASIGNACION,
+    OP_MOSTRAR,
+    OP_LLAMADA,
+    OP_METODO,
+    OP_CADA,
+    OP_FIN_CADA,
+    OP_RETORNAR,
+    OP_LISTA,
+    OP_CADA_ENTRADA,
+    OP_FIN_CADA_ENTRADA,
+    NUM_OPERACIONES
+};
+
+struct Operando {
+    bool valido = false;
+    bool literal = false;
+    double valor = 0.0;
+    string nombre;
+};
+
+struct Instruccion {
+    Operacion op = OP_GENERICA;
+    int destino = 0;   // salto principal (si falso, salida del bucle, cuerpo de contar...)
+    int destino2 = 0;  // contar!: salida del bucle
+    char operador = 0; // '+', '-', '*' o comparación: '<', '>', 'l' (<=), 'g' (>=), '=', '!'
+    bool declara = false; // vn x = ...
+    string nombre;        // variable de destino o de control
+    string texto, texto2; // condición completa / inicio y fin de contar
+    Operando a, b;
+};
+
+extern vector<Instruccion> instrucciones; // una por línea de script
+extern bool frecuencia_ops;               // --frecuencia-ops
+
+class Instrucciones {
+public:
+    static void decodificar() {
+        instrucciones.assign(script.size(), Instruccion());
+        for (int i = 0; i < (int)script.size(); i++) decodificar_linea(i);
+    }
+
+    static const char* nombre(int op) {
+        static const char* const nombres[NUM_OPERACIONES] = {
+            "otra", "si", "mientras", "si_compara", "mientras_compara", "sino", "si!", "mientras!",
+            "contar", "contar!", "funcion", "funcion!", "asigna_aritmetica", "asignacion", "mostrar",
+            "llamada", "metodo", "cada", "cada!", "retornar", "ln/lt/mapa", "cada_entrada", "cada_entrada!"
+        };
+        return (op >= 0 && op < NUM_OPERACIONES) ? nombres[op] : "inicio";
+    }
+
+    // --- FRECUENCIAS (--frecuencia-ops) ---
+    // Pares (anterior, actual) del hilo principal; los trabajadores de
+    // cada_paralelo no se cuentan.
+    static uint64_t (&pares())[NUM_OPERACIONES + 1][NUM_OPERACIONES] {
+        static uint64_t tabla[NUM_OPERACIONES + 1][NUM_OPERACIONES] = {};
+        return tabla;
+    }
+
+    static int& anterior() {
+        static int op = NUM_OPERACIONES; // "inicio"
+        return op;
+    }
+
+    static void anotar(Operacion op) {
+        pares()[anterior()][op]++;
+        anterior() = op;
+    }
+
+    static void informe(ostream& salida, size_t max_pares = 20) {
+        uint64_t total = 0, por_op[NUM_OPERACIONES] = {};
+        vector<pair<uint64_t, pair<int, int>>> lista;
+        for (int a = 0; a <= NUM_OPERACIONES; a++) {
+            for (int b = 0; b < NUM_OPERACIONES; b++) {
+                uint64_t n = pares()[a][b];
+                if (!n) continue;
+                total += n;
+                por_op[b] += n;
+                lista.push_back({n, {a, b}});
+            }
+        }
+        sort(lista.rbegin(), lista.rend());
+        salida << "--- FRECUENCIA DE OPERACIONES (" << total << ") ---" << endl;
+        for (int op = 0; op < NUM_OPERACIONES; op++) {
+            if (por_op[op]) salida << setw(20) << left << nombre(op) << right << setw(14) << por_op[op] << endl;
+        }
+        salida << "--- PARES MAS FRECUENTES ---" << endl;
+        for (size_t i = 0; i < lista.size() && i < max_pares; i++) {
+            salida << setw(20) << left << nombre(lista[i].second.first) << " -> " << setw(20) << nombre(lista[i].second.second)
+                   << right << setw(14) << lista[i].first << endl;
+        }
+    }
+
+private:
+    static string recortar(const string& s) {
+        size_t f = s.find_first_not_of(" \t\r\n");
+        if (f == string::npos) return "";
+        size_t l = s.find_last_not_of(" \t\r\n");
+        return s.substr(f, l - f + 1);
+    }
+
+    // saltos[i] tal como lo leería la ejecución (0 si no existe)
+    static int salto(int i) {
+        auto it = saltos.find(i);
+        return it != saltos.end() ? it->second : 0;
+    }
+
+    static bool es_nombre(const string& s) {
+        if (s.empty() || isdigit((unsigned char)s[0])) return false;
+        for (char c : s) if (!isalnum((unsigned char)c) && c != '_') return false;
+        // Y, O y NO son operadores lógicos para evaluar_condicion_maestra
+        string m = s;
+        transform(m.begin(), m.end(), m.begin(), ::toupper);
+        return m != "Y" && m != "O" && m != "NO";
+    }
+
+    // Un nombre o un número sin signo ni exponente ("12", "0.5")
+    static Operando operando(const string& texto) {
+        Operando o;
+        string t = recortar(texto);
+        if (es_nombre(t)) { o.valido = true; o.nombre = t; return o; }
+        if (t.empty() || t.find_first_not_of("0123456789.") != string::npos || t.find_first_of("0123456789") == string::npos ||
+            count(t.begin(), t.end(), '.') > 1) return o;
+        o.valido = o.literal = true;
+        o.valor = strtod(t.c_str(), nullptr);
+        return o;
+    }
+
+    // "a < b" (un solo operador de comparación y dos operandos simples)
+    static bool comparacion(const string& cond, Instruccion& in) {
+        static const char* const ops[] = {"==", "!=", ">=", "<=", ">", "<"};
+        static const char codigos[] = {'=', '!', 'g', 'l', '>', '<'};
+        for (int k = 0; k < 6; k++) {
+            size_t pos = cond.find(ops[k]);
+            if (pos == string::npos) continue;
+            Operando a = operando(cond.substr(0, pos));
+            Operando b = operando(cond.substr(pos + char_traits<char>::length(ops[k])));
+            if (!a.valido || !b.valido) return false;
+            in.a = a; in.b = b; in.operador = codigos[k];
+            return true;
+        }
+        return false;
+    }
+
+    // "a + b", "a - b", "a * b" o un solo operando
+    static bool aritmetica(const string& expr, Instruccion& in) {
+        string e = recortar(expr);
+        size_t pos = e.find_first_of("+-*", 1);
+        if (pos == string::npos) {
+            in.a = operando(e);
+            in.operador = 0;
+            return in.a.valido;
+        }
+        in.a = operando(e.substr(0, pos));
+        in.b = operando(e.substr(pos + 1));
+        in.operador = e[pos];
+        return in.a.valido && in.b.valido;
+    }
+
+    static void decodificar_linea(int i) {
+        const string& instr = script[i];
+        Instruccion& in = instrucciones[i];
+        stringstream ss(instr);
+        string cmd; ss >> cmd;
+        string raw_cmd = cmd;
+        if (cmd.find('(') != string::npos) cmd = cmd.substr(0, cmd.find('('));
+        size_t p1 = instr.find('(');
+        size_t p2 = instr.find_last_of(')');
+        bool parentesis = p1 != string::npos && p2 != string::npos;
+
+        if (cmd == "si" || cmd == "mientras") {
+            in.texto = parentesis ? instr.substr(p1 + 1, p2 - p1 - 1) : "";
+            in.destino = salto(i);
+            bool simple = comparacion(in.texto, in);
+            if (cmd == "si") in.op = simple ? OP_SI_COMPARA : OP_SI;
+            else in.op = simple ? OP_MIENTRAS_COMPARA : OP_MIENTRAS;
+        }
+        else if (cmd == "sino") { in.op = OP_SINO; in.destino = salto(i); }
+        else if (cmd == "si!") in.op = OP_FIN_SI;
+        else if (cmd == "mientras!") { in.op = OP_FIN_MIENTRAS; in.destino = salto(i); }
+        else if (cmd == "funcion") { in.op = OP_FUNCION; in.destino = salto(i) + 1; }
+        else if (cmd == "funcion!") in.op = OP_FIN_FUNCION;
+        else if (cmd == "contar" && parentesis) {
+            stringstream ss_c(instr.substr(p1 + 1, p2 - p1 - 1));
+            string de, a;
+            ss_c >> in.nombre >> de >> in.texto >> a >> in.texto2;
+            in.b = operando(in.texto2);
+            in.destino = salto(i);
+            in.op = OP_CONTAR;
+        }
+        else if (cmd == "contar!") {
+            int ini = salto(i);
+            if (ini >= 0 && ini < i && instrucciones[ini].op == OP_CONTAR) {
+                const Instruccion& cabecera = instrucciones[ini];
+                in.op = OP_FIN_CONTAR;
+                in.nombre = cabecera.nombre;
+                in.b = cabecera.b;
+                in.destino = ini;
+                in.destino2 = cabecera.destino;
+            }
+        }
+        else if (cmd == "cada") {
+            in.op = OP_CADA;
+            if (parentesis) {
+                stringstream ss_c(instr.substr(p1 + 1, p2 - p1 - 1));
+                string en, origen;
+                ss_c >> in.nombre >> en;
+                getline(ss_c, origen);
+                origen = recortar(origen);
+                if (origen == "entrada_lineas" || origen.rfind("entrada_csv", 0) == 0) {
+                    in.op = OP_CADA_ENTRADA;
+                    in.texto = origen;
+                    in.destino = salto(i);
+                }
+            }
+        }
+        else if (cmd == "cada!") {
+            int ini = salto(i);
+            in.op = (ini >= 0 && ini < i && instrucciones[ini].op == OP_CADA_ENTRADA) ? OP_FIN_CADA_ENTRADA : OP_FIN_CADA;
+            in.destino = ini;
+        }
+        else if (cmd == "retornar") in.op = OP_RETORNAR;
+        else if (cmd == "mostrar") in.op = OP_MOSTRAR;
+        else if (cmd == "ln" || cmd == "lt" || cmd == "mapa") in.op = OP_LISTA;
+        else if (raw_cmd.find('.') != string::npos || raw_cmd.find('[') != string::npos) in.op = OP_METODO;
+        else if (funciones.count(cmd) && p1 != string::npos && instr.find('=') == string::npos) in.op = OP_LLAMADA;
+        else if (instr.find('=') != string::npos && instr.find("==") == string::npos) {
+            in.op = OP_ASIGNACION;
+            size_t eq = instr.find('=');
+            stringstream ss_l(instr.substr(0, eq));
+            string primero, segundo, sobra;
+            ss_l >> primero >> segundo >> sobra;
+            bool declara = primero == "vn";
+            string nombre = declara ? segundo : primero;
+            if ((declara ? sobra : segundo).empty() && es_nombre(nombre)) {
+                string rhs = recortar(instr.substr(eq + 1));
+                // La forma general trata "entrada..." y el texto aparte
+                if (rhs.rfind("entrada", 0) != 0 && rhs.find('"') == string::npos && aritmetica(rhs, in)) {
+                    in.op = OP_ASIGNA_ARITMETICA;
+                    in.declara = declara;
+                    in.nombre = nombre;
+                }
+            }
+        }
+    }
+};
+
+#endif
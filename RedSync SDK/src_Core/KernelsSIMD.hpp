@@ -0,0 +1,285 @@
+#ifndef KERNELS_SIMD_HPP
+#define KERNELS_SIMD_HPP
+
+#include <cstddef>
+#include <cmath>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define REDSYNC_X86 1
+#endif
+
+using namespace std;
+
+// --- NÚCLEOS NUMÉRICOS VECTORIZADOS ---
+// Recorridos sobre bloques contiguos de double (el almacenamiento de 'ln').
+// En x86 con GCC/MinGW se elige AVX2 (con FMA o POPCNT donde se usan) en
+// tiempo de ejecución si el procesador lo tiene; si no, SSE2 (siempre presente
+// en x86-64) o el bucle escalar.
+
+class KernelsSIMD {
+public:
+    enum Comparacion { MAYOR, MENOR, MAYOR_IGUAL, MENOR_IGUAL, IGUAL, DISTINTO };
+
+    static double suma(const double* d, size_t n) {
+#ifdef REDSYNC_X86
+        if (tiene_avx2()) return suma_avx2(d, n);
+#endif
+#ifdef __SSE2__
+        return suma_sse2(d, n);
+#else
+        return suma_escalar(d, n, 0);
+#endif
+    }
+
+    static double minimo(const double* d, size_t n) {
+        if (n == 0) return 0.0;
+#ifdef REDSYNC_X86
+        if (tiene_avx2()) return extremo_avx2(d, n, false);
+#endif
+        return extremo_escalar(d, n, 0, d[0], false);
+    }
+
+    static double maximo(const double* d, size_t n) {
+        if (n == 0) return 0.0;
+#ifdef REDSYNC_X86
+        if (tiene_avx2()) return extremo_avx2(d, n, true);
+#endif
+        return extremo_escalar(d, n, 0, d[0], true);
+    }
+
+    // Σ (x - media)²
+    static double suma_desviaciones(const double* d, size_t n, double media) {
+#ifdef REDSYNC_X86
+        if (tiene_avx2_fma()) return desviaciones_avx2(d, n, media);
+#endif
+        return desviaciones_escalar(d, n, 0, media);
+    }
+
+    static double producto_punto(const double* a, const double* b, size_t n) {
+#ifdef REDSYNC_X86
+        if (tiene_avx2_fma()) return punto_avx2(a, b, n);
+#endif
+        return punto_escalar(a, b, n, 0);
+    }
+
+    static size_t contar_si(const double* d, size_t n, Comparacion op, double valor) {
+#ifdef REDSYNC_X86
+        if (tiene_avx2_popcnt() && op != IGUAL && op != DISTINTO) return contar_avx2(d, n, op, valor);
+#endif
+        return contar_escalar(d, n, 0, op, valor);
+    }
+
+    // r[i] = a[i] (op) b[i]; r puede coincidir con a o con b.
+    // Misma aritmética que aplicar_mat: dividir (o % ) entre cero da 0.
+    static void operar(char op, const double* a, const double* b, double* r, size_t n) {
+        size_t i = 0;
+#ifdef REDSYNC_X86
+        if (tiene_avx2() && (op == '+' || op == '-' || op == '*' || op == '/')) i = operar_avx2(op, a, b, r, n);
+#endif
+        for (; i < n; i++) {
+            switch (op) {
+                case '+': r[i] = a[i] + b[i]; break;
+                case '-': r[i] = a[i] - b[i]; break;
+                case '*': r[i] = a[i] * b[i]; break;
+                case '/': r[i] = (b[i] != 0.0) ? a[i] / b[i] : 0.0; break;
+                case '%': r[i] = (b[i] != 0.0) ? fmod(a[i], b[i]) : 0.0; break;
+                default:  r[i] = pow(a[i], b[i]); break;
+            }
+        }
+    }
+
+private:
+    // --- ESCALAR (también remata las colas de los caminos vectoriales) ---
+    static double suma_escalar(const double* d, size_t n, size_t i) {
+        double s = 0.0;
+        for (; i < n; i++) s += d[i];
+        return s;
+    }
+
+    static double extremo_escalar(const double* d, size_t n, size_t i, double actual, bool es_max) {
+        for (; i < n; i++) {
+            if (es_max ? d[i] > actual : d[i] < actual) actual = d[i];
+        }
+        return actual;
+    }
+
+    static double desviaciones_escalar(const double* d, size_t n, size_t i, double media) {
+        double s = 0.0;
+        for (; i < n; i++) { double x = d[i] - media; s += x * x; }
+        return s;
+    }
+
+    static double punto_escalar(const double* a, const double* b, size_t n, size_t i) {
+        double s = 0.0;
+        for (; i < n; i++) s += a[i] * b[i];
+        return s;
+    }
+
+    // Misma tolerancia que el operador == de las condiciones
+    static bool cumple(double x, Comparacion op, double v) {
+        switch (op) {
+            case MAYOR: return x > v;
+            case MENOR: return x < v;
+            case MAYOR_IGUAL: return x >= v;
+            case MENOR_IGUAL: return x <= v;
+            case IGUAL: return fabs(x - v) < 1e-5;
+            case DISTINTO: return fabs(x - v) > 1e-5;
+        }
+        return false;
+    }
+
+    static size_t contar_escalar(const double* d, size_t n, size_t i, Comparacion op, double v) {
+        size_t c = 0;
+        for (; i < n; i++) if (cumple(d[i], op, v)) c++;
+        return c;
+    }
+
+#ifdef __SSE2__
+    static double suma_sse2(const double* d, size_t n) {
+        __m128d a0 = _mm_setzero_pd(), a1 = _mm_setzero_pd();
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            a0 = _mm_add_pd(a0, _mm_loadu_pd(d + i));
+            a1 = _mm_add_pd(a1, _mm_loadu_pd(d + i + 2));
+        }
+        double t[2];
+        _mm_storeu_pd(t, _mm_add_pd(a0, a1));
+        return t[0] + t[1] + suma_escalar(d, n, i);
+    }
+#endif
+
+#ifdef REDSYNC_X86
+    static bool tiene_avx2() {
+        static const bool avx2 = __builtin_cpu_supports("avx2");
+        return avx2;
+    }
+
+    // Cada núcleo se elige solo si el procesador tiene TODO lo que pide su
+    // target(): hay máquinas virtuales que exponen AVX2 sin FMA
+    static bool tiene_avx2_fma() {
+        static const bool fma = tiene_avx2() && __builtin_cpu_supports("fma");
+        return fma;
+    }
+
+    static bool tiene_avx2_popcnt() {
+        static const bool popcnt = tiene_avx2() && __builtin_cpu_supports("popcnt");
+        return popcnt;
+    }
+
+    __attribute__((target("avx2")))
+    static double horizontal(__m256d v) {
+        double t[4];
+        _mm256_storeu_pd(t, v);
+        return (t[0] + t[1]) + (t[2] + t[3]);
+    }
+
+    // Cuatro acumuladores independientes para no esperar a cada suma
+    __attribute__((target("avx2")))
+    static double suma_avx2(const double* d, size_t n) {
+        __m256d a0 = _mm256_setzero_pd(), a1 = _mm256_setzero_pd();
+        __m256d a2 = _mm256_setzero_pd(), a3 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            a0 = _mm256_add_pd(a0, _mm256_loadu_pd(d + i));
+            a1 = _mm256_add_pd(a1, _mm256_loadu_pd(d + i + 4));
+            a2 = _mm256_add_pd(a2, _mm256_loadu_pd(d + i + 8));
+            a3 = _mm256_add_pd(a3, _mm256_loadu_pd(d + i + 12));
+        }
+        for (; i + 4 <= n; i += 4) a0 = _mm256_add_pd(a0, _mm256_loadu_pd(d + i));
+        __m256d t = _mm256_add_pd(_mm256_add_pd(a0, a1), _mm256_add_pd(a2, a3));
+        return horizontal(t) + suma_escalar(d, n, i);
+    }
+
+    __attribute__((target("avx2")))
+    static double extremo_avx2(const double* d, size_t n, bool es_max) {
+        if (n < 8) return extremo_escalar(d, n, 1, d[0], es_max);
+        __m256d a0 = _mm256_loadu_pd(d), a1 = _mm256_loadu_pd(d + 4);
+        size_t i = 8;
+        if (es_max) {
+            for (; i + 8 <= n; i += 8) {
+                a0 = _mm256_max_pd(a0, _mm256_loadu_pd(d + i));
+                a1 = _mm256_max_pd(a1, _mm256_loadu_pd(d + i + 4));
+            }
+            a0 = _mm256_max_pd(a0, a1);
+        } else {
+            for (; i + 8 <= n; i += 8) {
+                a0 = _mm256_min_pd(a0, _mm256_loadu_pd(d + i));
+                a1 = _mm256_min_pd(a1, _mm256_loadu_pd(d + i + 4));
+            }
+            a0 = _mm256_min_pd(a0, a1);
+        }
+        double t[4];
+        _mm256_storeu_pd(t, a0);
+        double r = extremo_escalar(t, 4, 1, t[0], es_max);
+        return extremo_escalar(d, n, i, r, es_max);
+    }
+
+    __attribute__((target("avx2,fma")))
+    static double desviaciones_avx2(const double* d, size_t n, double media) {
+        __m256d m = _mm256_set1_pd(media);
+        __m256d a0 = _mm256_setzero_pd(), a1 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256d x0 = _mm256_sub_pd(_mm256_loadu_pd(d + i), m);
+            __m256d x1 = _mm256_sub_pd(_mm256_loadu_pd(d + i + 4), m);
+            a0 = _mm256_fmadd_pd(x0, x0, a0);
+            a1 = _mm256_fmadd_pd(x1, x1, a1);
+        }
+        return horizontal(_mm256_add_pd(a0, a1)) + desviaciones_escalar(d, n, i, media);
+    }
+
+    __attribute__((target("avx2,fma")))
+    static double punto_avx2(const double* a, const double* b, size_t n) {
+        __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), s0);
+            s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), s1);
+        }
+        return horizontal(_mm256_add_pd(s0, s1)) + punto_escalar(a, b, n, i);
+    }
+
+    // Devuelve cuántos elementos procesó; el resto lo remata el bucle escalar
+    __attribute__((target("avx2")))
+    static size_t operar_avx2(char op, const double* a, const double* b, double* r, size_t n) {
+        size_t i = 0;
+        __m256d cero = _mm256_setzero_pd();
+        for (; i + 4 <= n; i += 4) {
+            __m256d x = _mm256_loadu_pd(a + i), y = _mm256_loadu_pd(b + i), z;
+            switch (op) {
+                case '+': z = _mm256_add_pd(x, y); break;
+                case '-': z = _mm256_sub_pd(x, y); break;
+                case '*': z = _mm256_mul_pd(x, y); break;
+                default: {
+                    __m256d es_cero = _mm256_cmp_pd(y, cero, _CMP_EQ_OQ);
+                    z = _mm256_blendv_pd(_mm256_div_pd(x, y), cero, es_cero);
+                }
+            }
+            _mm256_storeu_pd(r + i, z);
+        }
+        return i;
+    }
+
+    // Cada comparación deja una máscara de 4 bits; popcount cuenta los aciertos
+    __attribute__((target("avx2,popcnt")))
+    static size_t contar_avx2(const double* d, size_t n, Comparacion op, double valor) {
+        __m256d v = _mm256_set1_pd(valor);
+        size_t c = 0, i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256d x = _mm256_loadu_pd(d + i), r;
+            switch (op) {
+                case MAYOR: r = _mm256_cmp_pd(x, v, _CMP_GT_OQ); break;
+                case MENOR: r = _mm256_cmp_pd(x, v, _CMP_LT_OQ); break;
+                case MAYOR_IGUAL: r = _mm256_cmp_pd(x, v, _CMP_GE_OQ); break;
+                default: r = _mm256_cmp_pd(x, v, _CMP_LE_OQ); break;
+            }
+            c += (size_t)__builtin_popcount(_mm256_movemask_pd(r));
+        }
+        return c + contar_escalar(d, n, i, op, valor);
+    }
+#endif
+};
+
+#endif
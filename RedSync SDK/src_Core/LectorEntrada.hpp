@@ -0,0 +1,161 @@
+#ifndef LECTOR_ENTRADA_HPP
+#define LECTOR_ENTRADA_HPP
+
+#include "Traza.hpp"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// --- LECTURA DE LA ENTRADA ESTÁNDAR ---
+// entrada(), cada (linea en entrada_lineas) y cada (fila en entrada_csv(","))
+// leen de aquí cuando el programa no tiene un origen_entrada (la API y el modo
+// servidor ponen el suyo). La entrada se lee en bloques de 64 KB con read() y
+// las líneas se cortan con memchr sobre el bloque; cada línea o campo se copia
+// una sola vez, directamente en la variable que lo recibe. Hay un solo búfer
+// para todo el proceso, así que entrada() y los bucles se pueden mezclar sin
+// perder datos. En una terminal read() devuelve cada línea al pulsar Intro.
+
+class LectorEntrada {
+public:
+    static const size_t BLOQUE = 64 * 1024;
+
+    // La siguiente línea, sin el salto (ni el \r de Windows). false al final.
+    static bool linea(string& destino) {
+        LectorEntrada& l = instancia();
+        lock_guard<mutex> lk(l.m);
+        const char* p;
+        size_t n;
+        if (!l.siguiente(p, n)) return false;
+        destino.assign(p, n);
+        return true;
+    }
+
+    // Los campos de la siguiente línea. 'campos' se reutiliza entre filas.
+    static bool fila(char sep, vector<string>& campos) {
+        LectorEntrada& l = instancia();
+        lock_guard<mutex> lk(l.m);
+        const char* p;
+        size_t n;
+        if (!l.siguiente(p, n)) return false;
+        partir(p, n, sep, campos);
+        return true;
+    }
+
+    // Corta 'n' bytes en campos separados por 'sep'. Un campo que empieza con
+    // comillas puede llevar el separador dentro y "" por cada comilla.
+    static void partir(const char* p, size_t n, char sep, vector<string>& campos) {
+        const char* f = p;
+        const char* fin = p + n;
+        size_t k = 0;
+        for (;;) {
+            if (k == campos.size()) campos.emplace_back();
+            string& c = campos[k++];
+            bool comillas = f < fin && *f == '"';
+            if (comillas) {
+                c.clear();
+                for (f++; f < fin; f++) {
+                    if (*f != '"') { c += *f; continue; }
+                    if (f + 1 < fin && f[1] == '"') { c += '"'; f++; continue; }
+                    f++;
+                    break;
+                }
+            }
+            const char* s = f < fin ? (const char*)memchr(f, sep, (size_t)(fin - f)) : nullptr;
+            if (!comillas) c.assign(f, (size_t)((s ? s : fin) - f));
+            if (!s) break;
+            f = s + 1;
+        }
+        campos.resize(k);
+    }
+
+    // Como stod, pero sin excepciones: 0 si el texto no empieza por un número
+    static double a_numero(const string& s) {
+        errno = 0;
+        char* fin;
+        double v = strtod(s.c_str(), &fin);
+        if (fin == s.c_str() || errno == ERANGE) return 0.0;
+        return v;
+    }
+
+    // Hay una persona escribiendo (no una tubería ni un archivo): solo
+    // entonces entrada() muestra su mensaje
+    static bool interactiva() {
+#ifdef _WIN32
+        static const bool t = _isatty(0) != 0;
+#else
+        static const bool t = isatty(0) != 0;
+#endif
+        return t;
+    }
+
+private:
+    mutex m;
+    vector<char> buf;
+    size_t ini = 0, fin = 0; // bytes sin consumir: buf[ini, fin)
+    bool agotada = false;
+
+    static LectorEntrada& instancia() { static LectorEntrada l; return l; }
+
+    // p/n: la siguiente línea dentro de buf, válida hasta la próxima llamada
+    bool siguiente(const char*& p, size_t& n) {
+        size_t buscado = ini;
+        for (;;) {
+            const char* salto = fin > buscado ? (const char*)memchr(buf.data() + buscado, '\n', fin - buscado) : nullptr;
+            if (salto) {
+                p = buf.data() + ini;
+                n = (size_t)(salto - p);
+                ini += n + 1;
+                break;
+            }
+            if (agotada) {
+                if (ini == fin) return false;
+                p = buf.data() + ini; // última línea sin salto
+                n = fin - ini;
+                ini = fin;
+                break;
+            }
+            buscado = fin;
+            rellenar(buscado);
+        }
+        if (n > 0 && p[n - 1] == '\r') n--;
+        return true;
+    }
+
+    // Mueve lo pendiente al principio y lee un bloque más (el búfer crece si
+    // una línea no cabe)
+    void rellenar(size_t& buscado) {
+        if (ini > 0) {
+            memmove(buf.data(), buf.data() + ini, fin - ini);
+            buscado -= ini;
+            fin -= ini;
+            ini = 0;
+        }
+        if (buf.size() - fin < BLOQUE / 2) buf.resize(buf.size() < BLOQUE ? BLOQUE : buf.size() * 2);
+        static const string nombre_traza = "entrada";
+        Traza::Tramo tramo(Traza::ENTRADA, nombre_traza);
+        for (;;) {
+#ifdef _WIN32
+            int r = _read(0, buf.data() + fin, (unsigned)(buf.size() - fin));
+#else
+            ssize_t r = read(0, buf.data() + fin, buf.size() - fin);
+#endif
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) agotada = true;
+            else fin += (size_t)r;
+            return;
+        }
+    }
+};
+
+#endif
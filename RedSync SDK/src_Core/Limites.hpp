@@ -0,0 +1,138 @@
+#ifndef LIMITES_HPP
+#define LIMITES_HPP
+
+#include "RedCodeCore.hpp"
+#include "Memoria.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+extern thread_local vector<Contexto> pila_memoria;
+extern thread_local const vector<Contexto>* pila_padre;
+extern thread_local bool en_tarea;
+
+// --- LÍMITES DE EJECUCIÓN ---
+// --max-pasos, --tiempo-max y --memoria-max acotan una ejecución para poder
+// correr scripts ajenos sin que un bucle sin fin o un 'agregar' sin tope se
+// queden con el proceso. ejecutar_desde llama a paso() en cada operación, que
+// solo descuenta un contador del hilo; cada PASOS_POR_REVISION operaciones se
+// suman al total de la ejecución (compartido con los trabajadores de
+// cada_paralelo) y se comparan los límites. La memoria es una estimación de lo
+// que ocupan las variables de los frames (Memoria.hpp) y se mide con menos
+// frecuencia: cada hilo mide su propia pila y suma la diferencia con su medida
+// anterior a un total de la ejecución, que es lo que se compara con el límite.
+// Al pasarse se lanza un ErrorRedSync: el script termina con
+// [ERROR] Linea N: ... en la línea que se iba a ejecutar.
+
+class Limites {
+public:
+    static const int PASOS_POR_REVISION = 1024;
+    static const int REVISIONES_POR_MEMORIA = 16;
+
+    // Al empezar cada ejecución, en el hilo que la corre
+    static void iniciar() {
+        pasos_totales().store(0, memory_order_relaxed);
+        inicio() = chrono::steady_clock::now();
+        revisiones() = 0;
+        cupo() = cuenta() = siguiente_cupo(0);
+        bytes_totales().store(0, memory_order_relaxed);
+        medido() = 0;
+    }
+
+    // Mientras vive, el hilo (trabajador de cada_paralelo, tarea o hilo) cuenta
+    // en el total de memoria; al destruirse retira lo que había sumado.
+    class AporteMemoria {
+    public:
+        AporteMemoria() { medido() = 0; revisiones() = 0; }
+        ~AporteMemoria() {
+            bytes_totales().fetch_sub((int64_t)medido(), memory_order_relaxed);
+            medido() = 0;
+        }
+        AporteMemoria(const AporteMemoria&) = delete;
+        AporteMemoria& operator=(const AporteMemoria&) = delete;
+    };
+
+    // Una operación de ejecutar_desde
+    static inline void paso() {
+        if (--cuenta() == 0) revisar();
+    }
+
+    // Un hilo bloqueado (en un canal) no hace pasos: quien lo tiene esperando
+    // lo llama de vez en cuando para que --tiempo-max también lo alcance
+    static void revisar_espera() {
+        comprobar_tiempo(" esperando en un canal");
+    }
+
+    static uint64_t pasos() { return pasos_totales().load(memory_order_relaxed) + (uint64_t)(cupo() - cuenta()); }
+
+    static double segundos() {
+        return chrono::duration<double>(chrono::steady_clock::now() - inicio()).count();
+    }
+
+    // Bytes que ocupan (aprox.) las variables de la pila de este hilo
+    static size_t bytes_en_uso() {
+        size_t total = 0;
+        for (const Contexto& c : pila_memoria) total += Memoria::bytes_de(c);
+        return total;
+    }
+
+private:
+    static int& cuenta() { static thread_local int c = PASOS_POR_REVISION; return c; }
+    static int& cupo() { static thread_local int c = PASOS_POR_REVISION; return c; }
+    static int& revisiones() { static thread_local int r = 0; return r; }
+    static atomic<uint64_t>& pasos_totales() { static atomic<uint64_t> t(0); return t; }
+    static atomic<int64_t>& bytes_totales() { static atomic<int64_t> t(0); return t; }
+    static size_t& medido() { static thread_local size_t m = 0; return m; } // lo que este hilo sumó al total
+    static chrono::steady_clock::time_point& inicio() { static chrono::steady_clock::time_point t; return t; }
+
+    // Con --max-pasos la última revisión cae justo en el paso que lo supera
+    static int siguiente_cupo(uint64_t hechos) {
+        if (max_pasos && max_pasos + 1 - hechos < (uint64_t)PASOS_POR_REVISION) return (int)(max_pasos + 1 - hechos);
+        return PASOS_POR_REVISION;
+    }
+
+    static void revisar() {
+        uint64_t total = pasos_totales().fetch_add((uint64_t)cupo(), memory_order_relaxed) + (uint64_t)cupo();
+        // Antes de lanzar: el contador no puede quedarse en 0 (los hilos del pool siguen vivos)
+        cupo() = cuenta() = siguiente_cupo(total > max_pasos ? 0 : total);
+
+        if (max_pasos && total > max_pasos)
+            throw ErrorRedSync("se supero el limite de pasos (--max-pasos=" + to_string(max_pasos) + ")");
+        comprobar_tiempo(" y " + to_string(total) + " pasos");
+        // Los picos por variable son de la pila del hilo principal
+        if (Memoria::contando() && pila_padre == nullptr && !en_tarea) Memoria::muestrear();
+        if (memoria_maxima && ++revisiones() % REVISIONES_POR_MEMORIA == 0) {
+            size_t propios = bytes_en_uso();
+            int64_t total = bytes_totales().fetch_add((int64_t)propios - (int64_t)medido(), memory_order_relaxed) +
+                            (int64_t)propios - (int64_t)medido();
+            medido() = propios;
+            size_t bytes = total > 0 ? (size_t)total : 0;
+            if (bytes > memoria_maxima)
+                throw ErrorRedSync("se supero la memoria maxima (--memoria-max=" + decimal(memoria_maxima / MEGA) +
+                                   "): las variables de todos los hilos ocupan unos " + decimal(bytes / MEGA) + " MB");
+        }
+    }
+
+    static void comprobar_tiempo(const string& detalle) {
+        if (tiempo_maximo <= 0) return;
+        double s = segundos();
+        if (s > tiempo_maximo)
+            throw ErrorRedSync("se supero el tiempo maximo (--tiempo-max=" + decimal(tiempo_maximo) + "): " +
+                               decimal(s) + " s" + detalle);
+    }
+
+    static constexpr double MEGA = 1024.0 * 1024.0;
+
+    static string decimal(double v) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.2f", v);
+        return buf;
+    }
+};
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef MAPA_HASH_HPP
+#define MAPA_HASH_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+using namespace std;
+
+// --- MAPA (clave de texto -> número o texto) ---
+// Tabla hash de direccionamiento abierto con sondeo lineal. La capacidad es
+// siempre potencia de dos y se rehace cuando las celdas ocupadas más las
+// borradas superan 3/4, así que buscar, poner y eliminar son O(1) de media.
+// Borrar deja una marca para no cortar las cadenas de sondeo.
+
+struct ValorMapa {
+    bool es_texto = false;
+    double num = 0.0;
+    string txt;
+};
+
+class MapaHash {
+public:
+    enum Estado : uint8_t { VACIA, OCUPADA, BORRADA };
+
+    struct Celda {
+        Estado estado = VACIA;
+        uint64_t hash = 0;
+        string clave;
+        ValorMapa valor;
+    };
+
+    size_t tamano() const { return usados; }
+    size_t capacidad() const { return celdas.size(); }
+
+    ValorMapa* buscar(const string& clave) {
+        size_t pos = localizar(clave, hash_clave(clave));
+        return pos == NO_ESTA ? nullptr : &celdas[pos].valor;
+    }
+    const ValorMapa* buscar(const string& clave) const {
+        size_t pos = localizar(clave, hash_clave(clave));
+        return pos == NO_ESTA ? nullptr : &celdas[pos].valor;
+    }
+    bool contiene(const string& clave) const { return buscar(clave) != nullptr; }
+
+    void poner(const string& clave, ValorMapa valor) {
+        uint64_t h = hash_clave(clave);
+        size_t pos = localizar(clave, h);
+        if (pos != NO_ESTA) { celdas[pos].valor = move(valor); return; }
+
+        if ((usados + borradas + 1) * 4 > celdas.size() * 3) {
+            size_t nueva = celdas.empty() ? 8 : celdas.size();
+            while ((usados + 1) * 2 > nueva) nueva *= 2; // tras rehacer queda a lo sumo a la mitad
+            rehacer(nueva);
+        }
+        Celda& c = celdas[hueco(h)];
+        if (c.estado == BORRADA) borradas--;
+        c.estado = OCUPADA;
+        c.hash = h;
+        c.clave = clave;
+        c.valor = move(valor);
+        usados++;
+    }
+
+    bool eliminar(const string& clave) {
+        size_t pos = localizar(clave, hash_clave(clave));
+        if (pos == NO_ESTA) return false;
+        Celda& c = celdas[pos];
+        c.estado = BORRADA;
+        c.clave.clear();
+        c.valor = ValorMapa();
+        usados--;
+        borradas++;
+        return true;
+    }
+
+    void limpiar() {
+        celdas.clear();
+        usados = borradas = 0;
+    }
+
+    // Recorrido por posición (cada (k en mapa)): primera celda ocupada a partir
+    // de 'pos', o capacidad() si no quedan.
+    size_t siguiente(size_t pos) const {
+        while (pos < celdas.size() && celdas[pos].estado != OCUPADA) pos++;
+        return pos;
+    }
+    const Celda& celda(size_t pos) const { return celdas[pos]; }
+
+private:
+    static const size_t NO_ESTA = (size_t)-1;
+
+    vector<Celda> celdas;
+    size_t usados = 0;
+    size_t borradas = 0;
+
+    static uint64_t hash_clave(const string& s) {
+        uint64_t h = 1469598103934665603ULL;
+        for (unsigned char c : s) { h ^= c; h *= 1099511628211ULL; }
+        return h ^ (h >> 29); // los bits bajos eligen la celda: se mezclan los altos
+    }
+
+    // La tabla nunca se llena (ver poner), así que siempre hay una celda VACIA
+    size_t localizar(const string& clave, uint64_t h) const {
+        if (celdas.empty()) return NO_ESTA;
+        size_t mascara = celdas.size() - 1;
+        for (size_t i = h & mascara;; i = (i + 1) & mascara) {
+            const Celda& c = celdas[i];
+            if (c.estado == VACIA) return NO_ESTA;
+            if (c.estado == OCUPADA && c.hash == h && c.clave == clave) return i;
+        }
+    }
+
+    // Primera celda libre (vacía o borrada) en la cadena de 'h'
+    size_t hueco(uint64_t h) const {
+        size_t mascara = celdas.size() - 1;
+        size_t i = h & mascara;
+        while (celdas[i].estado == OCUPADA) i = (i + 1) & mascara;
+        return i;
+    }
+
+    void rehacer(size_t nueva_capacidad) {
+        vector<Celda> viejas(nueva_capacidad);
+        viejas.swap(celdas);
+        borradas = 0;
+        for (Celda& c : viejas) {
+            if (c.estado != OCUPADA) continue;
+            celdas[hueco(c.hash)] = move(c);
+        }
+    }
+};
+
+#endif
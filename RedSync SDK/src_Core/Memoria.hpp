@@ -0,0 +1,267 @@
+#ifndef MEMORIA_HPP
+#define MEMORIA_HPP
+
+#include "RedCodeCore.hpp"
+#include <atomic>
+#include <mutex>
+#include <map>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iomanip>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#define REDSYNC_TAMANO_RESERVA(p) _msize(p)
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#define REDSYNC_TAMANO_RESERVA(p) malloc_size(p)
+#else
+#include <malloc.h>
+#define REDSYNC_TAMANO_RESERVA(p) malloc_usable_size(p)
+#endif
+
+using namespace std;
+
+extern thread_local vector<Contexto> pila_memoria;
+
+// --- CONTABILIDAD DE MEMORIA (--memoria, sistema.memoria) ---
+// Dos fuentes:
+//  - Las reservas del proceso: el ejecutable sustituye operator new/delete
+//    (main.cpp) y, con --memoria, cuenta reservas, liberaciones y bytes vivos
+//    con el tamaño real que da el malloc del sistema.
+//  - Lo que ocupa cada variable, calculado desde sus contenedores: nodo del
+//    map, capacidad de los vectores y texto que no cabe dentro del string.
+//    Los picos por variable y por función salen de muestrear la pila cada
+//    1024 operaciones (ver Limites::revisar), así que un pico más corto que
+//    eso puede no verse.
+
+class Memoria {
+public:
+    struct Medida {
+        const char* tipo = "";
+        size_t elementos = 0;
+        size_t bytes = 0;
+    };
+
+    // --- BYTES DE LAS VARIABLES ---
+    // Sin 'exacto' las listas lt y los mapas grandes se estiman con una muestra
+    // de MUESTRA textos (lo que usan --memoria-max y el muestreo).
+
+    static size_t externo(const string& s) {
+        const char* d = s.data();
+        const char* o = reinterpret_cast<const char*>(&s);
+        return (d >= o && d < o + sizeof(string)) ? 0 : s.capacity() + 1;
+    }
+
+    static size_t textos(const vector<string>& v, bool exacto) {
+        size_t b = v.capacity() * sizeof(string);
+        if (exacto || v.size() <= MUESTRA) {
+            for (const string& s : v) b += externo(s);
+            return b;
+        }
+        size_t suma = 0, salto = v.size() / MUESTRA;
+        for (size_t i = 0; i < MUESTRA; i++) suma += externo(v[i * salto]);
+        return b + (size_t)((double)suma / MUESTRA * v.size());
+    }
+
+    static size_t mapa(const MapaHash& m, bool exacto) {
+        size_t cap = m.capacidad();
+        size_t b = cap * sizeof(MapaHash::Celda);
+        if (cap == 0) return b;
+        size_t n = (exacto || cap < MUESTRA) ? cap : MUESTRA, salto = cap / n, suma = 0;
+        for (size_t i = 0; i < n; i++) {
+            const MapaHash::Celda& c = m.celda(i * salto);
+            if (c.estado == MapaHash::OCUPADA) suma += externo(c.clave) + externo(c.valor.txt);
+        }
+        return b + (size_t)((double)suma / n * cap);
+    }
+
+    static bool medir(const Contexto& c, const string& nombre, Medida& m, bool exacto) {
+        size_t nodo = NODO + externo(nombre);
+        if (!c.vn.empty()) { auto it = c.vn.find(nombre); if (it != c.vn.end()) { m = {"vn", 1, nodo + sizeof(*it)}; return true; } }
+        if (!c.vt.empty()) { auto it = c.vt.find(nombre); if (it != c.vt.end()) { m = {"vt", it->second.size(), nodo + sizeof(*it) + externo(it->second)}; return true; } }
+        if (!c.ln.empty()) { auto it = c.ln.find(nombre); if (it != c.ln.end()) { m = {"ln", it->second.size(), nodo + sizeof(*it) + it->second.capacity() * sizeof(double)}; return true; } }
+        if (!c.lt.empty()) { auto it = c.lt.find(nombre); if (it != c.lt.end()) { m = {"lt", it->second.size(), nodo + sizeof(*it) + textos(it->second, exacto)}; return true; } }
+        if (!c.mp.empty()) { auto it = c.mp.find(nombre); if (it != c.mp.end()) { m = {"mapa", it->second.tamano(), nodo + sizeof(*it) + mapa(it->second, exacto)}; return true; } }
+        return false;
+    }
+
+    // Llama a fn(nombre, medida) por cada variable del frame
+    template <typename Fn>
+    static void recorrer(const Contexto& c, bool exacto, Fn fn) {
+        for (const auto& v : c.vn) fn(v.first, Medida{"vn", 1, NODO + sizeof(v) + externo(v.first)});
+        for (const auto& v : c.vt) fn(v.first, Medida{"vt", v.second.size(), NODO + sizeof(v) + externo(v.first) + externo(v.second)});
+        for (const auto& v : c.ln) fn(v.first, Medida{"ln", v.second.size(), NODO + sizeof(v) + externo(v.first) + v.second.capacity() * sizeof(double)});
+        for (const auto& v : c.lt) fn(v.first, Medida{"lt", v.second.size(), NODO + sizeof(v) + externo(v.first) + textos(v.second, exacto)});
+        for (const auto& v : c.mp) fn(v.first, Medida{"mapa", v.second.tamano(), NODO + sizeof(v) + externo(v.first) + mapa(v.second, exacto)});
+    }
+
+    static size_t bytes_de(const Contexto& c, bool exacto = false) {
+        size_t b = sizeof(Contexto);
+        recorrer(c, exacto, [&](const string&, const Medida& m) { b += m.bytes; });
+        return b;
+    }
+
+    // --- RESERVAS DEL PROCESO ---
+
+    static bool& contando() { static bool activo = false; return activo; }
+
+    static void anotar_reserva(void* p) {
+        Contadores& c = contadores();
+        int64_t n = (int64_t)REDSYNC_TAMANO_RESERVA(p);
+        c.reservas.fetch_add(1, memory_order_relaxed);
+        int64_t vivos = c.vivos.fetch_add(n, memory_order_relaxed) + n;
+        int64_t pico = c.pico.load(memory_order_relaxed);
+        while (vivos > pico && !c.pico.compare_exchange_weak(pico, vivos, memory_order_relaxed)) {}
+    }
+
+    static void anotar_liberacion(void* p) {
+        Contadores& c = contadores();
+        c.liberaciones.fetch_add(1, memory_order_relaxed);
+        c.vivos.fetch_sub((int64_t)REDSYNC_TAMANO_RESERVA(p), memory_order_relaxed);
+    }
+
+    // --- PICOS (muestreo de la pila del hilo principal) ---
+
+    static void muestrear() {
+        lock_guard<mutex> lk(cerrojo());
+        Picos& p = picos();
+        map<string, pair<size_t, size_t>> por_funcion; // bytes y frames de cada función ahora
+        for (size_t i = 0; i < pila_memoria.size(); i++) {
+            const Contexto& c = pila_memoria[i];
+            const string& etiqueta = etiqueta_de(c, i);
+            size_t total = sizeof(Contexto);
+            recorrer(c, false, [&](const string& nombre, const Medida& m) {
+                total += m.bytes;
+                Medida& maxima = p.variables[etiqueta + "." + nombre];
+                if (m.bytes >= maxima.bytes) maxima = m;
+            });
+            auto& f = por_funcion[etiqueta];
+            f.first += total;
+            f.second++;
+        }
+        for (auto& f : por_funcion) {
+            PicoFuncion& pf = p.funciones[f.first];
+            pf.bytes = max(pf.bytes, f.second.first);
+            pf.frames = max(pf.frames, f.second.second);
+        }
+    }
+
+    static void reiniciar() {
+        lock_guard<mutex> lk(cerrojo());
+        picos() = Picos();
+    }
+
+    // sistema.memoria("nombre"): la variable tal como la ve el script
+    static bool describir(const string& nombre, string& texto, size_t& bytes) {
+        for (size_t i = pila_memoria.size(); i-- > 0;) {
+            Medida m;
+            if (!medir(pila_memoria[i], nombre, m, true)) continue;
+            string etiqueta = etiqueta_de(pila_memoria[i], i);
+            size_t pico = m.bytes;
+            {
+                lock_guard<mutex> lk(cerrojo());
+                auto it = picos().variables.find(etiqueta + "." + nombre);
+                if (it != picos().variables.end()) pico = max(pico, it->second.bytes);
+            }
+            bytes = m.bytes;
+            texto = "[MEMORIA] " + nombre + " (" + m.tipo + ", " + etiqueta + "): " + to_string(m.elementos) +
+                    (string(m.tipo) == "vt" ? " caracteres, " : " elementos, ") + legible(m.bytes) + " (pico " + legible(pico) + ")";
+            return true;
+        }
+        return false;
+    }
+
+    // --memoria al terminar y sistema.memoria() sin argumentos
+    static void informe(ostream& salida, size_t max_variables = 20) {
+        muestrear();
+        lock_guard<mutex> lk(cerrojo());
+        const Picos& p = picos();
+        salida << "--- MEMORIA ---" << endl;
+        if (contando()) {
+            const Contadores& c = contadores();
+            salida << "Reservas: " << c.reservas.load() << "  Liberaciones: " << c.liberaciones.load()
+                   << "  En uso: " << legible((size_t)max<int64_t>(0, c.vivos.load()))
+                   << "  Pico: " << legible((size_t)max<int64_t>(0, c.pico.load())) << endl;
+        }
+
+        salida << "--- FRAMES (ahora / pico) ---" << endl;
+        map<string, pair<size_t, size_t>> ahora;
+        for (size_t i = 0; i < pila_memoria.size(); i++) {
+            auto& a = ahora[etiqueta_de(pila_memoria[i], i)];
+            a.first += bytes_de(pila_memoria[i], true);
+            a.second++;
+        }
+        for (const auto& f : p.funciones) {
+            auto a = ahora.count(f.first) ? ahora[f.first] : make_pair((size_t)0, (size_t)0);
+            salida << setw(24) << left << f.first << right << setw(6) << a.second << " frames " << setw(11) << legible(a.first)
+                   << "   pico " << setw(11) << legible(f.second.bytes) << " (" << f.second.frames << " frames)" << endl;
+        }
+
+        salida << "--- VARIABLES (ahora / pico) ---" << endl;
+        vector<pair<size_t, string>> orden;
+        for (const auto& v : p.variables) orden.push_back({v.second.bytes, v.first});
+        sort(orden.rbegin(), orden.rend());
+        for (size_t i = 0; i < orden.size() && i < max_variables; i++) {
+            const string& clave = orden[i].second;
+            const Medida& pico = p.variables.at(clave);
+            size_t punto = clave.find('.');
+            Medida m;
+            bool viva = medir_viva(clave.substr(0, punto), clave.substr(punto + 1), m);
+            salida << setw(24) << left << clave << right << setw(6) << pico.tipo << setw(12) << (viva ? m.elementos : 0)
+                   << setw(11) << (viva ? legible(m.bytes) : "-") << "   pico " << setw(11) << legible(viva ? max(pico.bytes, m.bytes) : pico.bytes)
+                   << " (" << pico.elementos << ")" << endl;
+        }
+    }
+
+    static string legible(size_t bytes) {
+        char buf[32];
+        if (bytes < 1024) snprintf(buf, sizeof(buf), "%zu B", bytes);
+        else if (bytes < 1024 * 1024) snprintf(buf, sizeof(buf), "%.1f KB", bytes / 1024.0);
+        else snprintf(buf, sizeof(buf), "%.1f MB", bytes / (1024.0 * 1024.0));
+        return buf;
+    }
+
+private:
+    static const size_t NODO = 4 * sizeof(void*); // nodo de map: tres punteros y el color
+    static const size_t MUESTRA = 64;
+
+    struct Contadores {
+        atomic<uint64_t> reservas{0}, liberaciones{0};
+        atomic<int64_t> vivos{0}, pico{0}; // con signo: lo reservado antes de activar se libera después
+    };
+
+    struct PicoFuncion {
+        size_t bytes = 0;
+        size_t frames = 0;
+    };
+
+    struct Picos {
+        map<string, Medida> variables;      // "funcion.variable" -> mayor medida vista
+        map<string, PicoFuncion> funciones; // "global" o el nombre de la función
+    };
+
+    static Contadores& contadores() { static Contadores c; return c; }
+    static Picos& picos() { static Picos p; return p; }
+    static mutex& cerrojo() { static mutex m; return m; }
+
+    // La variable en el frame más reciente de esa función (o el global)
+    static bool medir_viva(const string& etiqueta, const string& nombre, Medida& m) {
+        for (size_t i = pila_memoria.size(); i-- > 0;) {
+            if (etiqueta_de(pila_memoria[i], i) == etiqueta) return medir(pila_memoria[i], nombre, m, true);
+        }
+        return false;
+    }
+
+    static const string& etiqueta_de(const Contexto& c, size_t indice) {
+        static const string global = "global", bloque = "(bloque)";
+        if (c.funcion) return *c.funcion;
+        return indice == 0 ? global : bloque;
+    }
+};
+
+#endif
@@ -0,0 +1,212 @@
+#ifndef MODO_SERVIDOR_HPP
+#define MODO_SERVIDOR_HPP
+
+#include "RedCodeCore.hpp"
+#include "RedSyncAPI.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <deque>
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+// --- MODO SERVIDOR (RedCore --servidor) ---
+// El núcleo queda residente y recibe peticiones por stdin. Cada petición es
+// una secuencia de líneas de cabecera; los textos van precedidos de su longitud
+// en bytes para que puedan contener saltos de línea:
+//
+//   ARCHIVO <ruta>              script desde disco
+//   CODIGO <n>\n<n bytes>       script en línea
+//   NUMERO <nombre> <valor>     variable de entrada vn
+//   TEXTO <nombre> <n>\n<bytes> variable de entrada vt
+//   LISTA <nombre> <v1> <v2>..  lista de entrada ln
+//   ENTRADA <n>\n<bytes>        líneas que recibirá entrada()
+//   LIMITES <pasos> <seg> <MB>  límites solo para esta petición (0 = sin límite;
+//                               sin esta línea valen los de la línea de órdenes)
+//   EJECUTAR                    ejecuta la petición
+//   SALIR                       termina el servidor
+//
+// La respuesta se escribe en stdout a medida que el script imprime:
+//   SALIDA <n>\n<bytes>   (tantas como haga falta)
+//   ERROR <n>\n<bytes>    (si el script no compila o no se puede leer)
+//   ESTADO <codigo>       (fin de la petición)
+//
+// Los scripts compilados se guardan en una caché LRU indexada por el hash del
+// contenido: un script que no cambia no se vuelve a leer ni a compilar.
+
+class ModoServidor {
+public:
+    static int ejecutar(size_t capacidad_cache) {
+        ios::sync_with_stdio(false);
+        ModoServidor servidor(capacidad_cache);
+        return servidor.bucle();
+    }
+
+private:
+    struct Peticion {
+        string fuente;
+        string error;
+        vector<pair<string, double>> numeros;
+        vector<pair<string, string>> textos;
+        vector<pair<string, vector<double>>> listas;
+        deque<string> entradas;
+        bool con_limites = false;
+        unsigned long long pasos = 0;
+        double segundos = 0, megas = 0;
+    };
+
+    struct EntradaCache {
+        uint64_t hash;
+        string fuente;
+        RedPrograma* prog;
+    };
+
+    size_t capacidad;
+    list<EntradaCache> lru; // la más reciente al principio
+    unordered_map<uint64_t, list<EntradaCache>::iterator> indice;
+
+    explicit ModoServidor(size_t cap) : capacidad(cap == 0 ? 1 : cap) {}
+
+    ~ModoServidor() {
+        for (auto& e : lru) red_liberar(e.prog);
+    }
+
+    int bucle() {
+        Peticion pet;
+        string linea;
+        while (getline(cin, linea)) {
+            if (!linea.empty() && linea.back() == '\r') linea.pop_back();
+            stringstream ss(linea);
+            string orden; ss >> orden;
+
+            if (orden == "SALIR") break;
+            else if (orden == "ARCHIVO") {
+                string ruta;
+                getline(ss >> ws, ruta);
+                ifstream f(ruta, ios::binary);
+                if (!f.is_open()) pet.error = "No se pudo abrir '" + ruta + "'";
+                else { stringstream contenido; contenido << f.rdbuf(); pet.fuente = contenido.str(); }
+            }
+            else if (orden == "CODIGO") {
+                size_t n = 0; ss >> n;
+                pet.fuente = leer_bytes(n);
+            }
+            else if (orden == "NUMERO") {
+                string nombre; double valor = 0;
+                ss >> nombre >> valor;
+                pet.numeros.push_back({nombre, valor});
+            }
+            else if (orden == "TEXTO") {
+                string nombre; size_t n = 0;
+                ss >> nombre >> n;
+                pet.textos.push_back({nombre, leer_bytes(n)});
+            }
+            else if (orden == "LISTA") {
+                string nombre; ss >> nombre;
+                vector<double> valores;
+                double v;
+                while (ss >> v) valores.push_back(v);
+                pet.listas.push_back({nombre, valores});
+            }
+            else if (orden == "ENTRADA") {
+                size_t n = 0; ss >> n;
+                stringstream lineas(leer_bytes(n));
+                string l;
+                while (getline(lineas, l)) pet.entradas.push_back(l);
+            }
+            else if (orden == "LIMITES") {
+                pet.con_limites = true;
+                ss >> pet.pasos >> pet.segundos >> pet.megas;
+            }
+            else if (orden == "EJECUTAR") {
+                atender(pet);
+                pet = Peticion();
+            }
+        }
+        return 0;
+    }
+
+    static string leer_bytes(size_t n) {
+        string datos(n, '\0');
+        if (n > 0) cin.read(&datos[0], (streamsize)n);
+        datos.resize((size_t)cin.gcount());
+        return datos;
+    }
+
+    static void responder(const char* tipo, const string& datos) {
+        cout << tipo << " " << datos.size() << "\n";
+        cout.write(datos.data(), (streamsize)datos.size());
+        cout.flush();
+    }
+
+    static void salida_cb(const char* texto, size_t longitud, void*) {
+        responder("SALIDA", string(texto, longitud));
+    }
+
+    RedPrograma* obtener_programa(const string& fuente, string& error) {
+        uint64_t h = hash_fuente(fuente);
+        auto it = indice.find(h);
+        if (it != indice.end() && it->second->fuente == fuente) {
+            lru.splice(lru.begin(), lru, it->second);
+            return lru.front().prog;
+        }
+
+        char msg[512] = "";
+        RedPrograma* prog = red_compilar_texto(fuente.c_str(), msg, sizeof(msg));
+        if (!prog) { error = msg; return nullptr; }
+        red_capturar_salida(prog, salida_cb, nullptr);
+
+        if (it != indice.end()) { // misma huella, otro texto: se reemplaza
+            red_liberar(it->second->prog);
+            lru.erase(it->second);
+            indice.erase(it);
+        }
+        lru.push_front({h, fuente, prog});
+        indice[h] = lru.begin();
+        while (lru.size() > capacidad) {
+            indice.erase(lru.back().hash);
+            red_liberar(lru.back().prog);
+            lru.pop_back();
+        }
+        return prog;
+    }
+
+    void atender(Peticion& pet) {
+        RedPrograma* prog = nullptr;
+        if (pet.error.empty()) prog = obtener_programa(pet.fuente, pet.error);
+        if (!prog) {
+            responder("ERROR", pet.error);
+            cout << "ESTADO 1" << endl;
+            return;
+        }
+
+        red_limpiar_entradas(prog);
+        for (auto& v : pet.numeros) red_definir_numero(prog, v.first.c_str(), v.second);
+        for (auto& v : pet.textos) red_definir_texto(prog, v.first.c_str(), v.second.c_str());
+        for (auto& v : pet.listas) red_definir_lista_numeros(prog, v.first.c_str(), v.second.data(), v.second.size());
+
+        deque<string>& entradas = pet.entradas;
+        origen_entrada = [&entradas](string& l) {
+            if (entradas.empty()) { l.clear(); return false; }
+            l = entradas.front();
+            entradas.pop_front();
+            return true;
+        };
+        uint64_t pasos_antes = max_pasos;
+        double tiempo_antes = tiempo_maximo;
+        size_t memoria_antes = memoria_maxima;
+        if (pet.con_limites) red_definir_limites(pet.pasos, pet.segundos, (size_t)(max(0.0, pet.megas) * 1024 * 1024));
+        int estado = red_ejecutar(prog);
+        if (pet.con_limites) red_definir_limites(pasos_antes, tiempo_antes, memoria_antes);
+        origen_entrada = nullptr;
+
+        cout << "ESTADO " << estado << endl;
+    }
+};
+
+#endif
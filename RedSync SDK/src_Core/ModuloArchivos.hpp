@@ -6,25 +6,22 @@
 #include <fstream>
 #include <vector>
 #include <string>
-#include <sstream>
 #include <iomanip>
 
 using namespace std;
 
 // Importamos la memoria global para que el módulo pueda consultar variables
-extern vector<Contexto> pila_memoria;
+extern thread_local vector<Contexto> pila_memoria;
 
 class ModuloArchivos {
 public:
     static void cargar() {
         
         // --- CREAR ARCHIVO ---
-        modulos_registrados["archivos.crear"] = [](string args_raw) {
-            auto args = parsear(args_raw);
+        // El nombre llega resuelto: "datos.json", una variable o una concatenación
+        registrar_comando("archivos.crear", {TipoParametro::TEXTO}, [](const vector<Argumento>& args) {
             if (args.empty()) return;
-
-            // Resolvemos si el nombre es una variable o texto directo
-            string nombre_final = resolver_string(args[0]);
+            const string& nombre_final = args[0].txt;
             
             ifstream check(nombre_final);
             if (check.good()) return; 
@@ -32,17 +29,16 @@ public:
             ofstream archivo(nombre_final);
             archivo << "{\n}";
             archivo.close();
-        };
+        });
 
         // --- ESCRIBIR (CON RESOLUCIÓN TOTAL) ---
-        modulos_registrados["archivos.escribir"] = [](string args_raw) {
-            auto args = parsear(args_raw);
+        registrar_comando("archivos.escribir", {TipoParametro::TEXTO, TipoParametro::TEXTO, TipoParametro::VALOR}, [](const vector<Argumento>& args) {
             if (args.size() < 3) return;
 
-            // 1. Resolvemos todos los parámetros
-            string nombre_final = resolver_string(args[0]); // ¿partida.json o archivo_log?
-            string clave = resolver_string(args[1]);                       
-            string valor_final = resolver_string(args[2]); // ¿68000 o btc_ahora?
+            // 1. Los parámetros ya llegan resueltos (¿68000 o btc_ahora?)
+            const string& nombre_final = args[0].txt;
+            const string& clave = args[1].txt;
+            const string& valor_final = args[2].txt;
 
             // 2. Leer datos existentes para no sobrescribir todo el archivo
             vector<pair<string, string>> datos;
@@ -89,16 +85,15 @@ public:
             escritura << "}";
             escritura.flush(); 
             escritura.close();
-        };
+        });
 
         // --- LEER ---
-        modulos_registrados["archivos.leer"] = [](string args_raw) {
-            auto args = parsear(args_raw);
+        registrar_comando("archivos.leer", {TipoParametro::TEXTO, TipoParametro::TEXTO, TipoParametro::DESTINO}, [](const vector<Argumento>& args) {
             if (args.size() < 3) return;
             
-            string nombre_final = resolver_string(args[0]);
-            string clave = args[1];
-            string var_dest = args[2];
+            const string& nombre_final = args[0].txt;
+            const string& clave = args[1].txt;
+            const string& var_dest = args[2].txt;
 
             ifstream archivo(nombre_final);
             string linea;
@@ -113,44 +108,72 @@ public:
                     }
                 }
             }
-        };
+        });
+
+        // --- LEER MAPA (todo el JSON de una vez) ---
+        registrar_comando("archivos.leer_mapa", {TipoParametro::TEXTO, TipoParametro::LISTA}, [](const vector<Argumento>& args) {
+            if (args.size() < 2) return;
+
+            const string& nombre_final = args[0].txt;
+            MapaHash* destino = get_mp_ptr(args[1].txt);
+            if (!destino) destino = &pila_memoria.back().mp[args[1].txt];
+            destino->limpiar();
+
+            ifstream archivo(nombre_final);
+            string linea;
+            while (getline(archivo, linea)) {
+                size_t pos = linea.find(":");
+                if (pos == string::npos) continue;
+                string c = limpiar_total(linea.substr(0, pos));
+                string v = limpiar_total(linea.substr(pos + 1));
+                if (c.empty()) continue;
+
+                ValorMapa valor;
+                if (es_numerico(v)) valor.num = stod(v);
+                else { valor.es_texto = true; valor.txt = v; }
+                destino->poner(c, valor);
+            }
+        });
+
+        // --- ESCRIBIR MAPA (reemplaza el archivo) ---
+        registrar_comando("archivos.escribir_mapa", {TipoParametro::TEXTO, TipoParametro::LISTA}, [](const vector<Argumento>& args) {
+            if (args.size() < 2) return;
+
+            const string& nombre_final = args[0].txt;
+            MapaHash* origen = get_mp_ptr(args[1].txt);
+            if (!origen) return;
+
+            ofstream escritura(nombre_final, ios::trunc);
+            if (!escritura.is_open()) return;
+
+            escritura << "{\n";
+            size_t escritos = 0;
+            for (size_t i = origen->siguiente(0); i < origen->capacidad(); i = origen->siguiente(i + 1)) {
+                const MapaHash::Celda& celda = origen->celda(i);
+                escritura << "    \"" << celda.clave << "\": ";
+                if (celda.valor.es_texto) escritura << "\"" << celda.valor.txt << "\"";
+                else escritura << setprecision(15) << celda.valor.num;
+                if (++escritos < origen->tamano()) escritura << ",";
+                escritura << "\n";
+            }
+            escritura << "}";
+        });
 
         // --- INSPECCIONAR ---
-        modulos_registrados["archivos.inspeccionar"] = [](string args_raw) {
-            auto args = parsear(args_raw);
+        registrar_comando("archivos.inspeccionar", {TipoParametro::TEXTO}, [](const vector<Argumento>& args) {
             if (args.empty()) return;
-            string nombre_final = resolver_string(args[0]);
+            const string& nombre_final = args[0].txt;
             
             ifstream f(nombre_final); 
             string l;
-            cout << "--- CONTENIDO JSON (" << nombre_final << ") ---" << endl;
-            if(!f.is_open()) cout << "[ERROR] No se pudo abrir el archivo." << endl;
-            while(getline(f, l)) cout << l << endl;
-            cout << "------------------------------------" << endl;
-        };
+            emitir_salida("--- CONTENIDO JSON (" + nombre_final + ") ---\n");
+            if(!f.is_open()) emitir_salida("[ERROR] No se pudo abrir el archivo.\n");
+            while(getline(f, l)) emitir_salida(l + "\n");
+            emitir_salida("------------------------------------\n");
+        });
     }
 
 private:
-    // Función auxiliar para saber si un string es una variable o un literal
-    static string resolver_string(string input) {
-        if (pila_memoria.empty()) return input;
-        auto& mem = pila_memoria.back();
-
-        // Si es variable numérica (vn)
-        if (mem.vn.count(input)) {
-            string val = to_string(mem.vn[input]);
-            val.erase(val.find_last_not_of('0') + 1, string::npos);
-            if (val.back() == '.') val.pop_back();
-            return val;
-        }
-        // Si es variable de texto (vt)
-        if (mem.vt.count(input)) {
-            return mem.vt[input];
-        }
-        // Si no es ninguna, es un texto literal
-        return input;
-    }
-
     static string limpiar_total(string s) {
         size_t f = s.find_first_not_of(" \t\n\r\",{}");
         size_t l = s.find_last_not_of(" \t\n\r\",{}");
@@ -158,22 +181,6 @@ private:
         return s.substr(f, l - f + 1);
     }
 
-    static vector<string> parsear(string raw) {
-        vector<string> res; 
-        stringstream ss(raw); 
-        string item;
-        while(getline(ss, item, ',')) {
-            size_t f = item.find_first_not_of(" "), l = item.find_last_not_of(" ");
-            if (f != string::npos) {
-                string t = item.substr(f, l - f + 1);
-                string out = "";
-                for(char c : t) if(c != '\"' && c != '\'') out += c;
-                res.push_back(out);
-            }
-        }
-        return res;
-    }
-
     static bool es_numerico(const string& s) {
         if (s.empty()) return false;
         bool punto = false;
@@ -4,80 +4,295 @@
 #include "RedCodeCore.hpp"
 #include <vector>
 #include <string>
-#include <sstream>
 #include <random> // El motor moderno
+#include <algorithm>
+#include <cstdint>
 
 using namespace std;
 
-extern vector<Contexto> pila_memoria; 
+extern thread_local vector<Contexto> pila_memoria;
+
+// --- MOTORES ---
+// Los tres cumplen la interfaz de <random> (min, max, operator()), así que las
+// mismas distribuciones sirven para cualquiera. mt19937 es el de siempre;
+// xoshiro y pcg ocupan un par de palabras de estado y son bastante más rápidos
+// para simulaciones que piden millones de números.
+
+// xoshiro256** (Blackman y Vigna)
+struct MotorXoshiro {
+    using result_type = uint64_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    uint64_t s[4];
+
+    // El estado se expande con splitmix64 para que ninguna semilla lo deje a cero
+    void sembrar(uint64_t semilla) {
+        for (uint64_t& x : s) {
+            uint64_t z = (semilla += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            x = z ^ (z >> 31);
+        }
+    }
+
+    result_type operator()() {
+        uint64_t r = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0]; s[3] ^= s[1]; s[1] ^= s[2]; s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return r;
+    }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+};
+
+// PCG32 XSH-RR (O'Neill): 64 bits de estado, salida de 32
+struct MotorPcg {
+    using result_type = uint32_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+
+    uint64_t estado = 0;
+    static const uint64_t INCREMENTO = 1442695040888963407ULL;
+
+    void sembrar(uint64_t semilla) {
+        estado = 0;
+        (*this)();
+        estado += semilla;
+        (*this)();
+    }
+
+    result_type operator()() {
+        uint64_t viejo = estado;
+        estado = viejo * 6364136223846793005ULL + INCREMENTO;
+        uint32_t x = (uint32_t)(((viejo >> 18) ^ viejo) >> 27);
+        uint32_t rot = (uint32_t)(viejo >> 59);
+        return (x >> rot) | (x << ((32 - rot) & 31));
+    }
+};
 
 class ModuloRandom {
+public:
+    enum Motor { MT, XOSHIRO, PCG };
+
+    // Lo que una tarea recibe del hilo que la lanza: su motor y, si ese hilo
+    // usa una semilla fija, una semilla propia derivada de ella. Así un script
+    // sembrado sigue siendo repetible aunque reparta el trabajo en tareas.
+    struct Herencia {
+        Motor motor = MT;
+        bool sembrado = false;
+        uint64_t semilla = 0;
+    };
+
+    // En el hilo que lanza, en el orden del programa: la n-ésima tarea recibe
+    // siempre la misma semilla, sin alterar la secuencia del que la lanza
+    static Herencia herencia_para_tarea() {
+        Estado& e = estado();
+        Herencia h;
+        h.motor = e.motor;
+        h.sembrado = e.sembrado;
+        if (e.sembrado) {
+            MotorXoshiro mezcla;
+            mezcla.sembrar(e.semilla ^ (++e.hijos * 0xD1B54A32D192ED03ULL));
+            h.semilla = mezcla();
+        }
+        return h;
+    }
+
+    // Al empezar la tarea, en su hilo
+    static void heredar(const Herencia& h) {
+        estado().motor = h.motor;
+        if (h.sembrado) sembrar(h.semilla);
+    }
+
 private:
+    // Cada hilo (el del programa, cada tarea) tiene sus propios motores, su
+    // motor elegido y su semilla
+    struct Estado {
+        Motor motor = MT;
+        bool sembrado = false; // random.semilla (propia o heredada)
+        uint64_t semilla = 0;
+        uint64_t hijos = 0;    // tareas lanzadas desde la última semilla
+    };
+
+    static Estado& estado() {
+        static thread_local Estado e;
+        return e;
+    }
+
+    static Motor& motor_actual() { return estado().motor; }
+
+    // Siembra los tres motores: cambiar de motor después sigue siendo repetible
+    static void sembrar(uint64_t semilla) {
+        get_engine().seed((mt19937::result_type)semilla);
+        get_xoshiro().sembrar(semilla);
+        get_pcg().sembrar(semilla);
+        Estado& e = estado();
+        e.sembrado = true;
+        e.semilla = semilla;
+        e.hijos = 0;
+    }
+
     // Generador de alta calidad sembrado con hardware (random_device)
+    // hasta que el script pida una semilla fija con random.semilla.
     static mt19937& get_engine() {
-        static random_device rd; 
-        static mt19937 engine(rd());
+        static thread_local mt19937 engine(random_device{}());
         return engine;
     }
 
+    static MotorXoshiro& get_xoshiro() {
+        static thread_local MotorXoshiro engine = [] { MotorXoshiro m; m.sembrar(((uint64_t)random_device()() << 32) | random_device()()); return m; }();
+        return engine;
+    }
+
+    static MotorPcg& get_pcg() {
+        static thread_local MotorPcg engine = [] { MotorPcg m; m.sembrar(((uint64_t)random_device()() << 32) | random_device()()); return m; }();
+        return engine;
+    }
+
+    // Ejecuta 'f' con el motor elegido. Se resuelve una vez por comando, no por
+    // número: el bucle de random.lista queda especializado para cada motor.
+    template <typename F>
+    static void con_motor(F f) {
+        switch (motor_actual()) {
+            case XOSHIRO: f(get_xoshiro()); break;
+            case PCG: f(get_pcg()); break;
+            default: f(get_engine()); break;
+        }
+    }
+
 public:
     static void cargar() {
         // --- 1. RANDOM NUMERO (Saltos erráticos y grandes) ---
-        modulos_registrados["random.numero"] = [](string args_raw) {
-            auto args = parsear(args_raw);
+        // Los límites pueden ser variables o expresiones: random.numero("n", 1, lados * 2)
+        registrar_comando("random.numero", {TipoParametro::DESTINO, TipoParametro::EXPRESION, TipoParametro::EXPRESION}, [](const vector<Argumento>& args) {
             if (args.size() < 3) return;
 
-            string var = args[0];
+            const string& var = args[0].txt;
             // Usamos long long para evitar cualquier residuo decimal
-            long long v_min = stoll(args[1]);
-            long long v_max = stoll(args[2]);
+            long long v_min = (long long)args[1].num;
+            long long v_max = (long long)args[2].num;
+            if (v_min > v_max) swap(v_min, v_max);
 
             uniform_int_distribution<long long> dist(v_min, v_max);
-            
-            // Guardamos como double porque tu Core lo requiere, 
+
+            // Guardamos como double porque tu Core lo requiere,
             // pero el valor es un entero puro (ej: 500.00000)
-            set_vn(var, (double)dist(get_engine()));
-        };
+            con_motor([&](auto& g) { set_vn(var, (double)dist(g)); });
+        });
 
         // --- 2. RANDOM ELEGIR ---
-        modulos_registrados["random.elegir"] = [](string args_raw) {
-            auto args = parsear(args_raw);
+        registrar_comando("random.elegir", {TipoParametro::DESTINO, TipoParametro::LISTA}, [](const vector<Argumento>& args) {
             if (args.size() < 2) return;
 
-            string var_dest = args[0];
-            string nombre_lista = args[1];
-            auto& memoria = pila_memoria.back();
+            const string& var_dest = args[0].txt;
+            const string& nombre_lista = args[1].txt;
 
-            if (memoria.ln.count(nombre_lista)) {
-                auto& lista = memoria.ln[nombre_lista];
-                if (lista.empty()) return;
-                uniform_int_distribution<int> dist(0, (int)lista.size() - 1);
-                set_vn(var_dest, lista[dist(get_engine())]);
+            if (vector<double>* lista = get_ln_ptr(nombre_lista)) {
+                if (lista->empty()) return;
+                uniform_int_distribution<size_t> dist(0, lista->size() - 1);
+                con_motor([&](auto& g) { set_vn(var_dest, (*lista)[dist(g)]); });
             }
-            else if (memoria.lt.count(nombre_lista)) {
-                auto& lista = memoria.lt[nombre_lista];
-                if (lista.empty()) return;
-                uniform_int_distribution<int> dist(0, (int)lista.size() - 1);
-                set_vt(var_dest, lista[dist(get_engine())]);
+            else if (vector<string>* lista = get_lt_ptr(nombre_lista)) {
+                if (lista->empty()) return;
+                uniform_int_distribution<size_t> dist(0, lista->size() - 1);
+                con_motor([&](auto& g) { set_vt(var_dest, (*lista)[dist(g)]); });
             }
-        };
+        });
 
-    }
+        // --- 3. RANDOM LISTA (n enteros de una vez) ---
+        // random.lista("dados", 1000000, 1, 6): rellena (o crea) la lista ln
+        registrar_comando("random.lista", {TipoParametro::DESTINO, TipoParametro::EXPRESION, TipoParametro::EXPRESION, TipoParametro::EXPRESION}, [](const vector<Argumento>& args) {
+            if (args.size() < 4) return;
+
+            vector<double>* destino = preparar_destino("random.lista", args[0].txt, args[1].num);
+            if (!destino) return;
+            long long v_min = (long long)args[2].num;
+            long long v_max = (long long)args[3].num;
+            if (v_min > v_max) swap(v_min, v_max);
+
+            uniform_int_distribution<long long> dist(v_min, v_max);
+            con_motor([&](auto& g) { for (double& x : *destino) x = (double)dist(g); });
+        });
+
+        // --- 4. RANDOM LISTA DECIMAL (reales uniformes en [min, max)) ---
+        registrar_comando("random.lista_decimal", {TipoParametro::DESTINO, TipoParametro::EXPRESION, TipoParametro::EXPRESION, TipoParametro::EXPRESION}, [](const vector<Argumento>& args) {
+            if (args.size() < 4) return;
+
+            vector<double>* destino = preparar_destino("random.lista_decimal", args[0].txt, args[1].num);
+            if (!destino) return;
+            double v_min = args[2].num;
+            double v_max = args[3].num;
+            if (v_min > v_max) swap(v_min, v_max);
+
+            uniform_real_distribution<double> dist(v_min, v_max);
+            con_motor([&](auto& g) { for (double& x : *destino) x = dist(g); });
+        });
+
+        // --- 5. RANDOM LISTA NORMAL (media, desviación) ---
+        registrar_comando("random.lista_normal", {TipoParametro::DESTINO, TipoParametro::EXPRESION, TipoParametro::EXPRESION, TipoParametro::EXPRESION}, [](const vector<Argumento>& args) {
+            if (args.size() < 4) return;
+
+            vector<double>* destino = preparar_destino("random.lista_normal", args[0].txt, args[1].num);
+            if (!destino) return;
+            double media = args[2].num;
+            double desviacion = args[3].num;
+            if (desviacion < 0) {
+                emitir_salida("[ERROR] random.lista_normal: la desviacion no puede ser negativa.\n");
+                return;
+            }
+
+            normal_distribution<double> dist(media, desviacion);
+            con_motor([&](auto& g) { for (double& x : *destino) x = dist(g); });
+        });
+
+        // --- 6. RANDOM BARAJAR (en su sitio, ln o lt) ---
+        registrar_comando("random.barajar", {TipoParametro::LISTA}, [](const vector<Argumento>& args) {
+            if (args.empty()) return;
+
+            if (vector<double>* lista = get_ln_ptr(args[0].txt)) {
+                con_motor([&](auto& g) { shuffle(lista->begin(), lista->end(), g); });
+            }
+            else if (vector<string>* lista = get_lt_ptr(args[0].txt)) {
+                con_motor([&](auto& g) { shuffle(lista->begin(), lista->end(), g); });
+            }
+            else emitir_salida("[ERROR] random.barajar: la lista '" + args[0].txt + "' no existe.\n");
+        });
+
+        // --- 7. RANDOM SEMILLA (ejecuciones repetibles) ---
+        registrar_comando("random.semilla", {TipoParametro::EXPRESION}, [](const vector<Argumento>& args) {
+            if (args.empty()) return;
+            sembrar((uint64_t)(long long)args[0].num);
+        });
+
+        // --- 8. RANDOM MOTOR ("mt", "xoshiro" o "pcg") ---
+        registrar_comando("random.motor", {TipoParametro::TEXTO}, [](const vector<Argumento>& args) {
+            if (args.empty()) return;
+
+            const string& nombre = args[0].txt;
+            if (nombre == "mt") motor_actual() = MT;
+            else if (nombre == "xoshiro") motor_actual() = XOSHIRO;
+            else if (nombre == "pcg") motor_actual() = PCG;
+            else emitir_salida("[ERROR] random.motor: '" + nombre + "' no existe (usa mt, xoshiro o pcg).\n");
+        });
 
-private:
-    static vector<string> parsear(string raw) {
-        vector<string> res;
-        stringstream ss(raw);
-        string item;
-        while(getline(ss, item, ',')) res.push_back(limpiar(item));
-        return res;
     }
 
-    static string limpiar(string s) {
-        string out = "";
-        for(char c : s) if(c != '\"' && c != '\'' && c > 32) out += c;
-        return out;
+private:
+    // Lista ln de destino con 'cantidad' elementos: se reutiliza si ya existe
+    static vector<double>* preparar_destino(const string& comando, const string& nombre, double n) {
+        if (n < 0) {
+            emitir_salida("[ERROR] " + comando + ": la cantidad no puede ser negativa.\n");
+            return nullptr;
+        }
+        vector<double>* destino = get_ln_ptr(nombre);
+        if (!destino) destino = &pila_memoria.back().ln[nombre];
+        destino->resize((size_t)n);
+        return destino;
     }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -2,6 +2,8 @@
 #define MODULO_SISTEMA_HPP
 
 #include "RedCodeCore.hpp"
+#include "Memoria.hpp"
+#include <sstream>
 #include <iostream>
 #include <thread> // Para el sleep
 #include <chrono> // Para el tiempo
@@ -11,25 +13,41 @@ public:
     static void cargar() {
         
         // --- 1. LIMPIAR PANTALLA ---
-        modulos_registrados["sistema.limpiar"] = [](string args) {
+        registrar_comando("sistema.limpiar", {}, [](const vector<Argumento>&) {
             #ifdef _WIN32
                 system("cls");
             #else
                 system("clear");
             #endif
-        };
+        });
 
         // --- 2. ESPERAR (SLEEP) ---
-        modulos_registrados["sistema.esperar"] = [](string args) {
-            // Limpiamos el argumento (por si viene con comillas o espacios)
-            string limpia = "";
-            for(char c : args) if(isdigit(c)) limpia += c;
-            
-            if(!limpia.empty()){
-                int ms = stoi(limpia);
-                std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        // Milisegundos; admite variables y expresiones: sistema.esperar(pausa * 2)
+        registrar_comando("sistema.esperar", {TipoParametro::EXPRESION}, [](const vector<Argumento>& args) {
+            if (args.empty() || args[0].num <= 0) return;
+            std::this_thread::sleep_for(std::chrono::milliseconds((long long)args[0].num));
+        });
+
+        // --- 3. MEMORIA ---
+        // sistema.memoria()             informe de frames y variables (como --memoria)
+        // sistema.memoria(lista)        bytes de una variable y su pico
+        // sistema.memoria(lista, b)     los bytes, en la vn 'b', sin imprimir
+        registrar_comando("sistema.memoria", {TipoParametro::LISTA, TipoParametro::DESTINO}, [](const vector<Argumento>& args) {
+            if (args.empty() || args[0].txt.empty()) {
+                std::ostringstream informe;
+                Memoria::informe(informe);
+                emitir_salida(informe.str());
+                return;
+            }
+            std::string texto;
+            size_t bytes = 0;
+            if (!Memoria::describir(args[0].txt, texto, bytes)) {
+                emitir_salida("[ERROR] sistema.memoria: la variable '" + args[0].txt + "' no existe.\n");
+                return;
             }
-        };
+            if (args.size() > 1 && !args[1].txt.empty()) set_vn(args[1].txt, (double)bytes);
+            else emitir_salida(texto + "\n");
+        });
 
     }
 };
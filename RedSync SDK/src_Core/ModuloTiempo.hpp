@@ -12,10 +12,10 @@ class ModuloTiempo {
 public:
     static void cargar() {
         // --- HORA ---
-        modulos_registrados["tiempo.hora"] = [](string args) {
-            string var, fmt;
-            parsear_argumentos(args, var, fmt);
-            if (var.empty()) return;
+        // tiempo.hora(var, formato): formato H, HM o (por defecto) HMS
+        registrar_comando("tiempo.hora", {TipoParametro::DESTINO, TipoParametro::TEXTO}, [](const vector<Argumento>& args) {
+            if (args.empty() || args[0].txt.empty()) return;
+            string fmt = formato(args);
 
             auto p = obtener_tiempo();
             stringstream ss;
@@ -23,14 +23,13 @@ public:
             else if (fmt == "HM") ss << setfill('0') << setw(2) << p.tm_hour << ":" << setw(2) << p.tm_min;
             else ss << setfill('0') << setw(2) << p.tm_hour << ":" << setw(2) << p.tm_min << ":" << setw(2) << p.tm_sec;
             
-            set_vt(var, ss.str(), false);
-        };
+            set_vt(args[0].txt, ss.str(), false);
+        });
 
         // --- FECHA ---
-        modulos_registrados["tiempo.fecha"] = [](string args) {
-            string var, fmt;
-            parsear_argumentos(args, var, fmt);
-            if (var.empty()) return;
+        registrar_comando("tiempo.fecha", {TipoParametro::DESTINO, TipoParametro::TEXTO}, [](const vector<Argumento>& args) {
+            if (args.empty() || args[0].txt.empty()) return;
+            string fmt = formato(args);
 
             auto p = obtener_tiempo();
             stringstream ss;
@@ -38,36 +37,29 @@ public:
             else if (fmt == "DM") ss << setfill('0') << setw(2) << p.tm_mday << "/" << setw(2) << (p.tm_mon + 1);
             else ss << setfill('0') << setw(2) << p.tm_mday << "/" << setw(2) << (p.tm_mon + 1) << "/" << (p.tm_year + 1900);
 
-            set_vt(var, ss.str(), false);
-        };
+            set_vt(args[0].txt, ss.str(), false);
+        });
 
         // --- AÑO ---
-        auto logica_anio = [](string args) {
-            string var, trash;
-            parsear_argumentos(args, var, trash);
-            if (var.empty()) return;
-            set_vn(var, (double)(obtener_tiempo().tm_year + 1900), false);
+        FuncionModulo logica_anio = [](const vector<Argumento>& args) {
+            if (args.empty() || args[0].txt.empty()) return;
+            set_vn(args[0].txt, (double)(obtener_tiempo().tm_year + 1900), false);
         };
 
-        modulos_registrados["tiempo.anio"] = logica_anio;
-        modulos_registrados["tiempo.anho"] = logica_anio;
-        modulos_registrados["tiempo.year"] = logica_anio;
+        registrar_comando("tiempo.anio", {TipoParametro::DESTINO}, logica_anio);
+        registrar_comando("tiempo.anho", {TipoParametro::DESTINO}, logica_anio);
+        registrar_comando("tiempo.year", {TipoParametro::DESTINO}, logica_anio);
         string n_utf8 = "tiempo.a"; n_utf8 += (char)0xC3; n_utf8 += (char)0xB1; n_utf8 += "o";
-        modulos_registrados[n_utf8] = logica_anio;
+        registrar_comando(n_utf8, {TipoParametro::DESTINO}, logica_anio);
 
     }
 
 private:
-    static void parsear_argumentos(string raw, string& out_var, string& out_fmt) {
-        size_t coma = raw.find(',');
-        string s_var = (coma == string::npos) ? raw : raw.substr(0, coma);
-        string s_fmt = (coma == string::npos) ? "" : raw.substr(coma + 1);
-        
-        out_var = "";
-        for(char c : s_var) if(isalnum((unsigned char)c) || c == '_') out_var += c;
-        
-        out_fmt = "";
-        for(char c : s_fmt) if(isalnum((unsigned char)c)) out_fmt += toupper((unsigned char)c);
+    // "hm", "HM" o "H:M" valen lo mismo
+    static string formato(const vector<Argumento>& args) {
+        string fmt = "";
+        if (args.size() > 1) for(char c : args[1].txt) if(isalnum((unsigned char)c)) fmt += toupper((unsigned char)c);
+        return fmt;
     }
 
     static std::tm obtener_tiempo() {
@@ -12,7 +12,7 @@
 using namespace std;
 
 // Necesitamos acceso a la memoria para inyectar las variables que trajo Python
-extern vector<Contexto> pila_memoria;
+extern thread_local vector<Contexto> pila_memoria;
 
 class ModuloWeb {
 public:
@@ -27,24 +27,22 @@ public:
         // web.leer("url", "clave", "var")
         // Aquí definimos qué hace C++ cuando ve esa línea (básicamente, nada, solo validar).
         
-        modulos_registrados["web.leer"] = [](string args_raw) {
+        registrar_comando("web.leer", {TipoParametro::TEXTO, TipoParametro::TEXTO, TipoParametro::DESTINO}, [](const vector<Argumento>& args) {
             // No hacemos la petición HTTP aquí (ya la hizo el IDE).
             // Solo verificamos si la variable llegó bien a la memoria.
-            
-            auto args = parsear(args_raw);
             if (args.size() < 3) return;
             
-            string var_destino = args[2]; // El tercer argumento es la variable
+            const string& var_destino = args[2].txt; // El tercer argumento es la variable
             
             // Verificación visual para el usuario
             if (existe_variable(var_destino)) {
                 // Opcional: Descomentar para depurar
                 // cout << "[WEB] Dato sincronizado en '" << var_destino << "'" << endl;
             } else {
-                cout << "[WEB-ERROR] La variable '" << var_destino << "' no recibio datos." << endl;
-                cout << "            Verifica tu conexion o la clave del JSON." << endl;
+                emitir_salida("[WEB-ERROR] La variable '" + var_destino + "' no recibio datos.\n");
+                emitir_salida("            Verifica tu conexion o la clave del JSON.\n");
             }
-        };
+        });
 
     }
 
@@ -91,32 +89,12 @@ private:
 
     // --- UTILIDADES ---
 
-    static bool existe_variable(string nombre) {
+    static bool existe_variable(const string& nombre) {
         if (pila_memoria.empty()) return false;
         auto& mem = pila_memoria.back();
         return (mem.vn.count(nombre) || mem.vt.count(nombre));
     }
 
-    static vector<string> parsear(string raw) {
-        vector<string> res;
-        stringstream ss(raw);
-        string item;
-        while(getline(ss, item, ',')) {
-            res.push_back(limpiar(item));
-        }
-        return res;
-    }
-
-    static string limpiar(string s) {
-        size_t f = s.find_first_not_of(" ");
-        size_t l = s.find_last_not_of(" ");
-        if (f == string::npos) return "";
-        string t = s.substr(f, (l - f + 1));
-        string out = "";
-        for(char c : t) if(c != '\"' && c != '\'') out += c;
-        return out;
-    }
-
     static bool es_numero(const string& s) {
         if (s.empty()) return false;
         try {
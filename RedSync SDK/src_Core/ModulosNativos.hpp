@@ -0,0 +1,197 @@
+#ifndef MODULOS_NATIVOS_HPP
+#define MODULOS_NATIVOS_HPP
+
+#include "RedCodeCore.hpp"
+#include "RedSyncModulo.h"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+using namespace std;
+
+extern thread_local vector<Contexto> pila_memoria;
+extern map<string, function<double(const vector<string>&)>> funciones_nativas;
+extern const double* buscar_vn(const string& nombre);
+extern const string* buscar_vt(const string& nombre);
+
+// --- MÓDULOS NATIVOS ---
+// importar("nombre") con un nombre que no es de los módulos incluidos busca
+// una biblioteca libredmod_nombre (ver RedSyncModulo.h), comprueba su versión
+// y le pasa la tabla RedAnfitrion para que registre sus comandos (por
+// registrar_comando, como los módulos incluidos) y sus funciones (en
+// funciones_nativas, junto a suma o promedio). La biblioteca no se descarga:
+// lo que registró sigue apuntando a su código.
+
+class ModulosNativos {
+public:
+    // false con el motivo en 'error' si no se encontró o no se pudo iniciar
+    static bool cargar(const string& nombre, string& error, bool& encontrado) {
+        encontrado = false;
+        if (nombre.empty()) return false;
+        for (char c : nombre) {
+            if (!isalnum((unsigned char)c) && c != '_') return false; // nada de rutas en el nombre
+        }
+
+        for (const string& carpeta : carpetas()) {
+            string ruta = carpeta + SEPARADOR + archivo_de(nombre);
+            if (!ifstream(ruta).good()) continue;
+            encontrado = true;
+            return abrir(ruta, error);
+        }
+        return false;
+    }
+
+private:
+#ifdef _WIN32
+    static const char SEPARADOR = '\\';
+    static const char SEPARADOR_LISTA = ';';
+    static string archivo_de(const string& nombre) { return "redmod_" + nombre + ".dll"; }
+#elif defined(__APPLE__)
+    static const char SEPARADOR = '/';
+    static const char SEPARADOR_LISTA = ':';
+    static string archivo_de(const string& nombre) { return "libredmod_" + nombre + ".dylib"; }
+#else
+    static const char SEPARADOR = '/';
+    static const char SEPARADOR_LISTA = ':';
+    static string archivo_de(const string& nombre) { return "libredmod_" + nombre + ".so"; }
+#endif
+
+    // Solo las carpetas indicadas: nunca la carpeta actual por defecto, donde
+    // un script podría dejar una biblioteca con archivos.escribir y cargarla
+    static vector<string> carpetas() {
+        vector<string> res = rutas_modulos;
+        if (const char* entorno = getenv("REDSYNC_MODULOS")) {
+            string actual;
+            for (const char* p = entorno; ; p++) {
+                if (*p == SEPARADOR_LISTA || *p == '\0') {
+                    if (!actual.empty()) res.push_back(actual);
+                    actual.clear();
+                    if (*p == '\0') break;
+                }
+                else actual += *p;
+            }
+        }
+        return res;
+    }
+
+    static bool abrir(const string& ruta, string& error) {
+#ifdef _WIN32
+        HMODULE lib = LoadLibraryA(ruta.c_str());
+        if (!lib) { error = ruta + ": no se pudo cargar (error " + to_string(GetLastError()) + ")"; return false; }
+        RedModuloVersionFn version = (RedModuloVersionFn)GetProcAddress(lib, "redsync_modulo_version");
+        RedModuloIniciarFn iniciar = (RedModuloIniciarFn)GetProcAddress(lib, "redsync_modulo_iniciar");
+        auto cerrar = [&] { FreeLibrary(lib); };
+#else
+        void* lib = dlopen(ruta.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!lib) { error = dlerror(); return false; }
+        RedModuloVersionFn version = (RedModuloVersionFn)dlsym(lib, "redsync_modulo_version");
+        RedModuloIniciarFn iniciar = (RedModuloIniciarFn)dlsym(lib, "redsync_modulo_iniciar");
+        auto cerrar = [&] { dlclose(lib); };
+#endif
+        if (!version || !iniciar) {
+            cerrar();
+            error = ruta + ": no exporta redsync_modulo_version y redsync_modulo_iniciar";
+            return false;
+        }
+        int v = version();
+        if (v != REDSYNC_MODULO_VERSION) {
+            cerrar();
+            error = ruta + ": version de modulo " + to_string(v) + ", el nucleo usa la " + to_string(REDSYNC_MODULO_VERSION);
+            return false;
+        }
+        // A partir de aquí puede haber registrado algo: no se cierra aunque falle
+        if (iniciar(&anfitrion()) != 0) {
+            error = ruta + ": redsync_modulo_iniciar devolvio error";
+            return false;
+        }
+        return true;
+    }
+
+    // --- TABLA QUE RECIBE EL MÓDULO ---
+
+    static const RedAnfitrion& anfitrion() {
+        static const RedAnfitrion tabla = {
+            REDSYNC_MODULO_VERSION,
+            registrar_comando_c, registrar_funcion_c,
+            definir_numero, definir_texto, leer_numero, leer_texto,
+            lista_numeros, redimensionar_lista,
+            emitir
+        };
+        return tabla;
+    }
+
+    struct ComandoC {
+        RedComandoFn fn;
+        void* usuario;
+    };
+
+    static void llamar_comando(const vector<Argumento>& args, void* datos) {
+        const ComandoC* c = (const ComandoC*)datos;
+        vector<RedArgumento> a(args.size());
+        for (size_t i = 0; i < args.size(); i++) a[i] = {args[i].es_texto ? 1 : 0, args[i].num, args[i].txt.c_str()};
+        c->fn(a.data(), a.size(), c->usuario);
+    }
+
+    static void registrar_comando_c(const char* nombre, const int* tipos, size_t n_tipos, RedComandoFn fn, void* usuario) {
+        if (!nombre || !fn) return;
+        vector<TipoParametro> t;
+        for (size_t i = 0; i < n_tipos; i++) {
+            int k = tipos[i];
+            t.push_back(k >= RED_EXPRESION && k <= RED_LISTA ? (TipoParametro)k : TipoParametro::EXPRESION);
+        }
+        // Vive lo mismo que la biblioteca: para siempre
+        registrar_comando(nombre, t, llamar_comando, new ComandoC{fn, usuario});
+    }
+
+    static void registrar_funcion_c(const char* nombre, RedFuncionFn fn, void* usuario) {
+        if (!nombre || !fn) return;
+        funciones_nativas[nombre] = [fn, usuario](const vector<string>& args) {
+            vector<double> v;
+            v.reserve(args.size());
+            for (const string& a : args) {
+                if (a.find_first_not_of(" \t") != string::npos) v.push_back(evaluar_matematica(a));
+            }
+            return fn(v.data(), v.size(), usuario);
+        };
+    }
+
+    static void definir_numero(const char* nombre, double valor) { if (nombre) set_vn(nombre, valor); }
+    static void definir_texto(const char* nombre, const char* valor) { if (nombre) set_vt(nombre, valor ? valor : ""); }
+
+    static int leer_numero(const char* nombre, double* valor) {
+        const double* v = nombre ? buscar_vn(nombre) : nullptr;
+        if (!v) return 0;
+        if (valor) *valor = *v;
+        return 1;
+    }
+
+    static const char* leer_texto(const char* nombre) {
+        const string* v = nombre ? buscar_vt(nombre) : nullptr;
+        return v ? v->c_str() : nullptr;
+    }
+
+    static double* lista_numeros(const char* nombre, size_t* n) {
+        vector<double>* l = nombre ? get_ln_ptr(nombre) : nullptr;
+        if (n) *n = l ? l->size() : 0;
+        return l ? l->data() : nullptr;
+    }
+
+    static double* redimensionar_lista(const char* nombre, size_t n) {
+        if (!nombre) return nullptr;
+        vector<double>* l = get_ln_ptr(nombre);
+        if (!l) l = &pila_memoria.back().ln[nombre];
+        l->resize(n);
+        return l->data();
+    }
+
+    static void emitir(const char* texto) { if (texto) emitir_salida(texto); }
+};
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef MUESTREO_HPP
+#define MUESTREO_HPP
+
+#include <atomic>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <thread>
+#include <chrono>
+#else
+#include <csignal>
+#include <sys/time.h>
+#endif
+
+using namespace std;
+
+extern vector<int> lineas_origen;
+
+// --- PERFILADOR POR MUESTREO (--muestreo=HZ) ---
+// El hilo que ejecuta el script publica dónde está en una ranura compartida:
+// la operación en curso (la pone ejecutar_desde) y la pila de llamadas del
+// script, cada función con la operación desde la que se la llamó (la ponen
+// LlamadaActiva y la llamada en cola). Todo son atómicos sin cerrojo, así que
+// se pueden leer desde un manejador de señal.
+//
+// Un temporizador ITIMER_PROF manda SIGPROF HZ veces por segundo de CPU; el
+// manejador copia la ranura y suma la muestra en una tabla de pilas reservada
+// de antemano (sin reservar memoria ni tomar cerrojos). En Windows, sin
+// SIGPROF, un hilo toma las muestras cada 1/HZ segundos de reloj.
+//
+// Al terminar se escribe una línea por pila en formato "folded" (el de
+// flamegraph.pl, speedscope o Perfetto): script:14;suma:10;cuad:4 37
+
+class Muestreo {
+public:
+    static const int PUBLICADA_MAX = 4096; // frames que se publican
+    static const int PROFUNDIDAD_MAX = 32; // frames (los más internos) que guarda cada muestra
+    static const int PILAS_MAX = 4096;     // pilas distintas en la tabla
+
+    static bool activo() { return estado().activo; }
+
+    static void activar(int hz, const string& ruta) {
+        Estado& e = estado();
+        e.ruta = ruta;
+        e.hz = hz < 1 ? 1 : hz;
+        e.pilas = new Pila[PILAS_MAX](); // vive hasta el final del proceso
+        e.activo = true;
+#ifdef _WIN32
+        thread([hz = e.hz]() {
+            for (;;) {
+                this_thread::sleep_for(chrono::microseconds(1000000 / hz));
+                tomar_muestra();
+            }
+        }).detach();
+#else
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = [](int) { tomar_muestra(); };
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGPROF, &sa, nullptr);
+        struct itimerval t;
+        t.it_interval.tv_sec = 0;
+        t.it_interval.tv_usec = 1000000 / e.hz;
+        if (t.it_interval.tv_usec == 0) t.it_interval.tv_usec = 1;
+        t.it_value = t.it_interval;
+        setitimer(ITIMER_PROF, &t, nullptr);
+#endif
+    }
+
+    // --- RANURA (solo la escribe el hilo del script) ---
+
+    static inline void publicar(int pc) { estado().pc.store(pc, memory_order_relaxed); }
+
+    static void entrar(const string* funcion) {
+        Estado& e = estado();
+        int d = e.profundidad.load(memory_order_relaxed);
+        if (d < PUBLICADA_MAX) {
+            e.nombres[d].store(funcion, memory_order_relaxed);
+            e.llamadas[d].store(e.pc.load(memory_order_relaxed), memory_order_relaxed);
+        }
+        e.profundidad.store(d + 1, memory_order_release);
+    }
+
+    static void salir() {
+        Estado& e = estado();
+        int d = e.profundidad.load(memory_order_relaxed) - 1;
+        if (d < 0) return;
+        e.profundidad.store(d, memory_order_release);
+        // Vuelve a la línea del que llamaba, que sigue en curso
+        if (d < PUBLICADA_MAX) e.pc.store(e.llamadas[d].load(memory_order_relaxed), memory_order_relaxed);
+    }
+
+    // Llamada en cola: el frame de arriba pasa a ser de otra función
+    static void reemplazar(const string* funcion) {
+        Estado& e = estado();
+        int d = e.profundidad.load(memory_order_relaxed) - 1;
+        if (d >= 0 && d < PUBLICADA_MAX) e.nombres[d].store(funcion, memory_order_relaxed);
+    }
+
+    // --- RESULTADO ---
+
+    static void volcar() {
+        Estado& e = estado();
+        if (!e.activo || e.volcado) return;
+        e.volcado = true;
+#ifndef _WIN32
+        struct itimerval cero;
+        memset(&cero, 0, sizeof(cero));
+        setitimer(ITIMER_PROF, &cero, nullptr);
+#endif
+        ofstream f(e.ruta, ios::binary);
+        if (!f.is_open()) {
+            fprintf(stderr, "[ERROR] --muestreo: no se pudo escribir '%s'\n", e.ruta.c_str());
+            return;
+        }
+        uint64_t total = 0;
+        for (int i = 0; i < PILAS_MAX; i++) {
+            const Pila& p = e.pilas[i];
+            if (p.estado.load(memory_order_acquire) != LISTA) continue;
+            uint64_t n = p.cuenta.load();
+            total += n;
+            if (p.truncada) f << "...;";
+            for (int k = 0; k < p.frames; k++) {
+                if (k) f << ';';
+                f << (p.nombres[k] ? p.nombres[k]->c_str() : "script") << ':' << linea(p.pcs[k]);
+            }
+            f << ' ' << n << '\n';
+        }
+        fprintf(stderr, "[MUESTREO] %llu muestras a %d Hz -> %s", (unsigned long long)total, e.hz, e.ruta.c_str());
+        if (e.perdidas.load()) fprintf(stderr, " (%llu sin sitio en la tabla)", (unsigned long long)e.perdidas.load());
+        fprintf(stderr, "\n");
+    }
+
+private:
+    enum : int { VACIA = 0, ESCRIBIENDO = 1, LISTA = 2 };
+
+    // Una pila distinta y cuántas veces se vio. nombres[k] == nullptr: el global
+    struct Pila {
+        atomic<int> estado{VACIA};
+        atomic<uint64_t> cuenta{0};
+        uint64_t hash = 0;
+        int frames = 0;
+        bool truncada = false;
+        const string* nombres[PROFUNDIDAD_MAX + 1];
+        int pcs[PROFUNDIDAD_MAX + 1];
+    };
+
+    struct Estado {
+        bool activo = false;
+        bool volcado = false;
+        int hz = 0;
+        string ruta;
+        atomic<int> pc{-1};
+        atomic<int> profundidad{0};
+        atomic<const string*> nombres[PUBLICADA_MAX];
+        atomic<int> llamadas[PUBLICADA_MAX];
+        Pila* pilas = nullptr;
+        atomic<uint64_t> perdidas{0};
+    };
+
+    static Estado& estado() { static Estado e; return e; }
+
+    static int linea(int pc) {
+        return (pc >= 0 && pc < (int)lineas_origen.size()) ? lineas_origen[pc] : 0;
+    }
+
+    // Dentro del manejador de señal: solo atómicos y memoria ya reservada
+    static void tomar_muestra() {
+        Estado& e = estado();
+        if (!e.pilas) return;
+
+        Pila m;
+        int d = e.profundidad.load(memory_order_acquire);
+        int publicados = d < PUBLICADA_MAX ? d : PUBLICADA_MAX;
+        // frame k (0 = global) está en la operación desde la que llamó al k+1
+        int desde = publicados + 1 > PROFUNDIDAD_MAX + 1 ? publicados - PROFUNDIDAD_MAX : 0;
+        m.truncada = desde > 0;
+        for (int k = desde; k <= publicados; k++) {
+            m.nombres[m.frames] = k == 0 ? nullptr : e.nombres[k - 1].load(memory_order_relaxed);
+            m.pcs[m.frames] = k < publicados ? e.llamadas[k].load(memory_order_relaxed) : e.pc.load(memory_order_relaxed);
+            m.frames++;
+        }
+        uint64_t h = 1469598103934665603ULL ^ (uint64_t)m.truncada;
+        for (int k = 0; k < m.frames; k++) {
+            h = (h ^ (uint64_t)(uintptr_t)m.nombres[k]) * 1099511628211ULL;
+            h = (h ^ (uint64_t)(uint32_t)m.pcs[k]) * 1099511628211ULL;
+        }
+        m.hash = h;
+
+        for (int i = 0; i < PILAS_MAX; i++) {
+            Pila& p = e.pilas[(h + (uint64_t)i) & (PILAS_MAX - 1)];
+            int st = p.estado.load(memory_order_acquire);
+            if (st == VACIA) {
+                int esperado = VACIA;
+                if (p.estado.compare_exchange_strong(esperado, ESCRIBIENDO, memory_order_acquire)) {
+                    p.hash = m.hash;
+                    p.frames = m.frames;
+                    p.truncada = m.truncada;
+                    memcpy(p.nombres, m.nombres, sizeof(m.nombres));
+                    memcpy(p.pcs, m.pcs, sizeof(m.pcs));
+                    p.cuenta.store(1, memory_order_relaxed);
+                    p.estado.store(LISTA, memory_order_release);
+                    return;
+                }
+                st = esperado;
+            }
+            if (st == LISTA && igual(p, m)) {
+                p.cuenta.fetch_add(1, memory_order_relaxed);
+                return;
+            }
+        }
+        e.perdidas.fetch_add(1, memory_order_relaxed);
+    }
+
+    static bool igual(const Pila& a, const Pila& b) {
+        if (a.hash != b.hash || a.frames != b.frames || a.truncada != b.truncada) return false;
+        for (int k = 0; k < a.frames; k++) {
+            if (a.nombres[k] != b.nombres[k] || a.pcs[k] != b.pcs[k]) return false;
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,360 @@
+#ifndef OPTIMIZADOR_HPP
+#define OPTIMIZADOR_HPP
+
+#include "RedCodeCore.hpp"
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <sstream>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+
+using namespace std;
+
+// --- OPTIMIZACIÓN AL CARGAR (-O0, -O1, -O2) ---
+// Trabaja sobre el script ya normalizado y con la tabla de saltos construida;
+// si cambia algo, quien lo llama vuelve a construir saltos y funciones.
+//
+//  -O1  Pliega las expresiones hechas solo de números (vn dia = 60 * 60 * 24
+//       pasa a vn dia = 86400, también los paréntesis sueltos de una expresión
+//       mayor) y quita los 'si' y 'mientras' cuya condición es constante.
+//  -O2  Además propaga las variables vn que se declaran una sola vez, en el
+//       nivel principal, con un valor constante y que nada más escribe: sus
+//       usos posteriores en expresiones y condiciones se sustituyen por el valor.
+//
+// Los valores se calculan con el mismo evaluar_matematica que usa la ejecución,
+// así que el resultado es idéntico al de no optimizar. La declaración se
+// conserva (la variable sigue existiendo para la API y para mostrar).
+
+class Optimizador {
+public:
+    // true si el script cambió
+    static bool optimizar(int nivel) {
+        if (nivel <= 0 || script.empty()) return false;
+        MarcoTemporal marco; // evaluar necesita un frame aunque no lea variables
+
+        map<string, string> constantes;
+        set<string> numericas, candidatas;
+        analizar(numericas, candidatas);
+        if (nivel < 2) candidatas.clear();
+
+        vector<bool> borrar(script.size(), false);
+        bool cambio = false;
+        int profundidad = 0, en_funcion = 0;
+
+        for (int i = 0; i < (int)script.size(); i++) {
+            string cmd = comando(script[i]);
+            if (es_cierre(cmd)) {
+                profundidad--;
+                if (cmd == "funcion!") en_funcion--;
+            }
+
+            if (!borrar[i]) {
+                string antes = script[i];
+                if (cmd == "si" || cmd == "mientras") {
+                    if (!en_funcion) script[i] = sustituir_condicion(script[i], constantes);
+                    podar_condicional(i, cmd, borrar);
+                }
+                else {
+                    string nombre;
+                    if (procesar_asignacion(script[i], en_funcion ? map<string, string>() : constantes, numericas, nombre) &&
+                        profundidad == 0 && !en_funcion && candidatas.count(nombre)) {
+                        string rhs = script[i].substr(script[i].find('=') + 1);
+                        constantes[nombre] = recortar(rhs);
+                    }
+                }
+                if (script[i] != antes) cambio = true;
+            }
+
+            if (es_apertura(cmd)) {
+                profundidad++;
+                if (cmd == "funcion") en_funcion++;
+            }
+        }
+
+        size_t quedan = 0;
+        for (size_t i = 0; i < script.size(); i++) {
+            if (borrar[i]) { cambio = true; continue; }
+            if (quedan != i) script[quedan] = move(script[i]);
+            lineas_origen[quedan] = lineas_origen[i];
+            quedan++;
+        }
+        script.resize(quedan);
+        lineas_origen.resize(quedan);
+        return cambio;
+    }
+
+private:
+    struct MarcoTemporal {
+        MarcoTemporal() { pila_memoria.push_back(Contexto()); }
+        ~MarcoTemporal() { pila_memoria.pop_back(); }
+    };
+
+    static string recortar(const string& s) {
+        size_t a = s.find_first_not_of(" \t");
+        if (a == string::npos) return "";
+        size_t b = s.find_last_not_of(" \t");
+        return s.substr(a, b - a + 1);
+    }
+
+    static string comando(const string& instr) {
+        stringstream ss(instr);
+        string cmd; ss >> cmd;
+        return cmd.substr(0, cmd.find('('));
+    }
+
+    static bool es_apertura(const string& cmd) {
+        return cmd == "si" || cmd == "mientras" || cmd == "contar" || cmd == "cada" ||
+               cmd == "cada_paralelo" || cmd == "funcion";
+    }
+    static bool es_cierre(const string& cmd) {
+        return cmd == "si!" || cmd == "mientras!" || cmd == "contar!" || cmd == "cada!" ||
+               cmd == "cada_paralelo!" || cmd == "funcion!";
+    }
+
+    static bool letra(char c) { return isalpha((unsigned char)c) || c == '_'; }
+    static bool letra_o_digito(char c) { return isalnum((unsigned char)c) || c == '_'; }
+
+    // Solo números, operadores aritméticos, puntos, espacios y paréntesis
+    static bool es_literal(const string& s) {
+        bool digito = false;
+        for (char c : s) {
+            if (isdigit((unsigned char)c)) digito = true;
+            else if (string("+-*/%^(). ").find(c) == string::npos) return false;
+        }
+        return digito;
+    }
+
+    static bool es_numero(const string& s) {
+        if (s.empty()) return false;
+        char* fin = nullptr;
+        strtod(s.c_str(), &fin);
+        return *fin == '\0' && s.find_first_of(" \t") == string::npos;
+    }
+
+    // Texto que vuelve a dar exactamente el mismo double al leerlo
+    static string numero_texto(double v) {
+        char buf[32];
+        if (v == floor(v) && fabs(v) < 1e15) snprintf(buf, sizeof(buf), "%.0f", v);
+        else snprintf(buf, sizeof(buf), "%.17g", v);
+        return buf;
+    }
+
+    static bool calcular(const string& expr, string& valor) {
+        double v = evaluar_matematica(expr);
+        if (!isfinite(v)) return false;
+        valor = numero_texto(v);
+        return true;
+    }
+
+    // Pliega los paréntesis de agrupación con contenido constante (los de una
+    // llamada, pegados a un nombre, se respetan) y después la expresión entera.
+    static string plegar(string expr) {
+        bool hubo = true;
+        while (hubo) {
+            hubo = false;
+            for (size_t i = 0; i < expr.size(); i++) {
+                if (expr[i] != '(') continue;
+                size_t j = i + 1;
+                while (j < expr.size() && expr[j] != '(' && expr[j] != ')') j++;
+                if (j >= expr.size() || expr[j] != ')') continue; // solo los más internos
+
+                size_t k = i;
+                while (k > 0 && expr[k - 1] == ' ') k--;
+                if (k > 0 && (letra_o_digito(expr[k - 1]) || expr[k - 1] == ']' || expr[k - 1] == '.')) continue;
+                if (k > 0 && expr[k - 1] == '-' && !tras_operando(expr, k - 1)) continue; // -(...) se lee como un solo término
+
+                string dentro = recortar(expr.substr(i + 1, j - i - 1));
+                string valor;
+                if (!es_literal(dentro) || es_numero(dentro) || !calcular(dentro, valor)) continue;
+                if (valor[0] == '-') valor = "(" + valor + ")";
+                expr.replace(i, j - i + 1, valor);
+                hubo = true;
+            }
+        }
+        string entera = recortar(expr), valor;
+        if (es_literal(entera) && !es_numero(entera) && calcular(entera, valor)) return valor;
+        return expr;
+    }
+
+    // true si el '-' de la posición 'pos' resta (lo precede un operando)
+    static bool tras_operando(const string& expr, size_t pos) {
+        while (pos > 0 && expr[pos - 1] == ' ') pos--;
+        return pos > 0 && (letra_o_digito(expr[pos - 1]) || expr[pos - 1] == ')' || expr[pos - 1] == ']');
+    }
+
+    // Sustituye los nombres de 'constantes' que aparecen como operando (no
+    // dentro de comillas, ni como llamada, índice, método o parte de otro nombre)
+    static string sustituir(const string& expr, const map<string, string>& constantes) {
+        if (constantes.empty()) return expr;
+        string res;
+        bool comillas = false;
+        for (size_t i = 0; i < expr.size();) {
+            char c = expr[i];
+            if (c == '"') comillas = !comillas;
+            if (comillas || !letra(c) || (i > 0 && (letra_o_digito(expr[i - 1]) || expr[i - 1] == '.'))) {
+                res += c; i++;
+                continue;
+            }
+            size_t fin = i;
+            while (fin < expr.size() && letra_o_digito(expr[fin])) fin++;
+            string nombre = expr.substr(i, fin - i);
+            size_t sig = expr.find_first_not_of(' ', fin);
+            bool operando = sig == string::npos || (expr[sig] != '(' && expr[sig] != '[' && expr[sig] != '.');
+            auto it = constantes.find(nombre);
+            res += (operando && it != constantes.end()) ? it->second : nombre;
+            i = fin;
+        }
+        return res;
+    }
+
+    static string sustituir_condicion(const string& instr, const map<string, string>& constantes) {
+        size_t p1 = instr.find('('), p2 = instr.find_last_of(')');
+        if (p1 == string::npos || p2 == string::npos || p2 < p1) return instr;
+        return instr.substr(0, p1 + 1) + sustituir(instr.substr(p1 + 1, p2 - p1 - 1), constantes) + instr.substr(p2);
+    }
+
+    // 'vn x = expr' o 'x = expr' con x numérica: propaga y pliega el lado
+    // derecho. Devuelve true (y el nombre) si la línea es una declaración vn
+    // cuyo valor quedó constante.
+    static bool procesar_asignacion(string& instr, const map<string, string>& constantes,
+                                    const set<string>& numericas, string& nombre) {
+        size_t eq = instr.find('=');
+        if (eq == string::npos || instr.find("==") != string::npos || eq == 0) return false;
+        if (string("+-*/<>!").find(instr[eq - 1]) != string::npos) return false;
+
+        stringstream ss(instr.substr(0, eq));
+        string primero, segundo, resto;
+        ss >> primero >> segundo >> resto;
+        bool declaracion = primero == "vn";
+        nombre = declaracion ? segundo : primero;
+        if ((declaracion ? !resto.empty() : !segundo.empty()) || nombre.empty() || !letra(nombre[0])) return false;
+        for (char c : nombre) if (!letra_o_digito(c)) return false;
+        if (!declaracion && !numericas.count(nombre)) return false;
+
+        string rhs = recortar(instr.substr(eq + 1));
+        if (rhs.empty() || rhs.find('"') != string::npos || rhs.rfind("entrada", 0) == 0) return false;
+
+        string nuevo = plegar(sustituir(rhs, constantes));
+        if (nuevo != rhs) instr = instr.substr(0, eq + 1) + " " + nuevo;
+        // Los negativos no se propagan: '-' delante de '-5' no se lee igual que '-x'
+        return declaracion && es_numero(nuevo) && nuevo[0] != '-';
+    }
+
+    // Condición sin nombres (solo números y los operadores y, o, no)
+    static bool condicion_constante(const string& cond) {
+        if (cond.find('"') != string::npos) return false;
+        bool digito = false;
+        for (size_t i = 0; i < cond.size();) {
+            if (isdigit((unsigned char)cond[i])) digito = true;
+            if (!letra(cond[i]) || (i > 0 && letra_o_digito(cond[i - 1]))) { i++; continue; }
+            size_t fin = i;
+            while (fin < cond.size() && letra_o_digito(cond[fin])) fin++;
+            string palabra = cond.substr(i, fin - i);
+            for (char& c : palabra) c = (char)toupper((unsigned char)c);
+            if (palabra != "Y" && palabra != "O" && palabra != "NO") return false;
+            i = fin;
+        }
+        return digito;
+    }
+
+    // Un 'si' constante deja solo la rama que se toma; un 'mientras' falso
+    // desaparece. Una rama que define funciones no se toca (se registran al
+    // cargar aunque no se ejecuten).
+    static void podar_condicional(int i, const string& cmd, vector<bool>& borrar) {
+        const string& instr = script[i];
+        size_t p1 = instr.find('('), p2 = instr.find_last_of(')');
+        if (p1 == string::npos || p2 == string::npos || p2 < p1 || !saltos.count(i)) return;
+        string cond = instr.substr(p1 + 1, p2 - p1 - 1);
+        if (!condicion_constante(cond)) return;
+        bool valor = evaluar_condicion_maestra(cond);
+
+        if (cmd == "mientras") {
+            int fin = saltos[i]; // una después de mientras!
+            if (valor || define_funciones(i, fin)) return;
+            for (int k = i; k < fin; k++) borrar[k] = true;
+            return;
+        }
+
+        int destino = saltos[i];
+        bool con_sino = destino > 0 && comando(script[destino - 1]) == "sino" && destino - 1 > i;
+        int sino = con_sino ? destino - 1 : -1;
+        int cierre = con_sino ? saltos[sino] : destino;
+        if (cierre <= i || cierre >= (int)script.size()) return;
+
+        int ini_muerta = valor ? sino : i, fin_muerta = valor ? cierre : sino + 1;
+        if (!con_sino) { ini_muerta = valor ? cierre : i; fin_muerta = valor ? cierre : cierre + 1; }
+        if (define_funciones(ini_muerta, fin_muerta)) return;
+
+        borrar[i] = true;
+        borrar[cierre] = true;
+        for (int k = ini_muerta; k < fin_muerta; k++) borrar[k] = true;
+    }
+
+    static bool define_funciones(int ini, int fin) {
+        for (int k = ini; k < fin; k++) if (comando(script[k]) == "funcion") return true;
+        return false;
+    }
+
+    // numericas: nombres que solo se declaran como vn y que ningún bucle,
+    // parámetro ni módulo escribe (a su lado derecho se le puede plegar).
+    // candidatas: las de esas que además se escriben una sola vez.
+    static void analizar(set<string>& numericas, set<string>& candidatas) {
+        map<string, int> escrituras;
+        set<string> excluidas, vn, otras;
+        for (const string& instr : script) {
+            string cmd = comando(instr);
+            stringstream ss(instr);
+            string primero, segundo;
+            ss >> primero >> segundo;
+            // esperar(t, r) y recibir(c, x) escriben en un argumento, también
+            // desde una condición o una expresión: su destino no es una
+            // constante aunque se declare una sola vez (vn r = 0)
+            if (escribe_argumentos(instr))
+                for (const string& p : palabras(instr)) excluidas.insert(p);
+
+            if (cmd == "vn" || cmd == "vt" || cmd == "ln" || cmd == "lt" || cmd == "mapa") {
+                string nombre = segundo.substr(0, segundo.find_first_of("=["));
+                escrituras[nombre]++;
+                (cmd == "vn" ? vn : otras).insert(nombre);
+            }
+            else if (cmd == "contar" || cmd == "cada" || cmd == "cada_paralelo" || cmd == "funcion" ||
+                     primero.find('.') != string::npos) {
+                for (const string& p : palabras(instr)) excluidas.insert(p);
+            }
+            else {
+                size_t fin = 0;
+                while (fin < instr.size() && letra_o_digito(instr[fin])) fin++;
+                if (fin > 0) escrituras[instr.substr(0, fin)]++;
+            }
+        }
+
+        for (const string& n : vn) if (!otras.count(n) && !excluidas.count(n)) numericas.insert(n);
+        for (const auto& e : escrituras)
+            if (e.second == 1 && numericas.count(e.first)) candidatas.insert(e.first);
+    }
+
+    static bool escribe_argumentos(const string& instr) {
+        for (const string& p : palabras(instr))
+            if (p == "esperar" || p == "recibir") return true;
+        return false;
+    }
+
+    // Todas las palabras de la línea, también las que van entre comillas
+    static vector<string> palabras(const string& instr) {
+        vector<string> res;
+        for (size_t i = 0; i < instr.size();) {
+            if (!letra(instr[i])) { i++; continue; }
+            size_t fin = i;
+            while (fin < instr.size() && letra_o_digito(instr[fin])) fin++;
+            res.push_back(instr.substr(i, fin - i));
+            i = fin;
+        }
+        return res;
+    }
+};
+
+#endif
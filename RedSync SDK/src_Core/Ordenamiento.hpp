@@ -0,0 +1,148 @@
+#ifndef ORDENAMIENTO_HPP
+#define ORDENAMIENTO_HPP
+
+#include "PoolHilos.hpp"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+// --- ORDENAMIENTO DE LISTAS ---
+// ln: radix sort LSD sobre la representación binaria del double (6 pasadas de
+//     11 bits, O(n) y estable; la tabla de cuentas cabe en la caché L1).
+// lt: por encima de UMBRAL_PARALELO, cada hilo del pool ordena un tramo y los
+//     tramos se mezclan por parejas en rondas (merge sort paralelo).
+// permutacion(): el orden estable de una lista de claves, para aplicarlo a
+//     varias listas paralelas a la vez (ordenar_por).
+
+class Ordenamiento {
+public:
+    static const size_t UMBRAL_RADIX = 1024; // por debajo std::sort es más rápido
+    static const size_t UMBRAL_PARALELO = 1 << 15;
+
+    static void ordenar(vector<double>& v) {
+        if (v.size() < UMBRAL_RADIX) { sort(v.begin(), v.end()); return; }
+        vector<uint64_t> claves(v.size());
+        for (size_t i = 0; i < v.size(); i++) claves[i] = clave_de(v[i]);
+        vector<uint64_t> aux(v.size());
+        radix(claves, aux, [](uint64_t k) { return k; });
+        for (size_t i = 0; i < v.size(); i++) v[i] = double_de(claves[i]);
+    }
+
+    static void ordenar(vector<string>& v) {
+        ordenar_paralelo(v, less<string>());
+    }
+
+    // Índices que dejan 'claves' en orden ascendente (a igual clave, orden original)
+    static vector<size_t> permutacion(const vector<double>& claves) {
+        size_t n = claves.size();
+        vector<size_t> perm(n);
+        if (n < UMBRAL_RADIX) {
+            for (size_t i = 0; i < n; i++) perm[i] = i;
+            stable_sort(perm.begin(), perm.end(), [&](size_t a, size_t b) { return claves[a] < claves[b]; });
+            return perm;
+        }
+        // La clave viaja junto al índice para que cada pasada lea memoria contigua
+        vector<pair<uint64_t, size_t>> pares(n), aux(n);
+        for (size_t i = 0; i < n; i++) pares[i] = {clave_de(claves[i]), i};
+        radix(pares, aux, [](const pair<uint64_t, size_t>& p) { return p.first; });
+        for (size_t i = 0; i < n; i++) perm[i] = pares[i].second;
+        return perm;
+    }
+
+    static vector<size_t> permutacion(const vector<string>& claves) {
+        vector<size_t> perm(claves.size());
+        for (size_t i = 0; i < perm.size(); i++) perm[i] = i;
+        ordenar_paralelo(perm, [&](size_t a, size_t b) { return claves[a] < claves[b]; });
+        return perm;
+    }
+
+    // v[i] pasa a ser v[perm[i]]
+    template <typename T>
+    static void aplicar(vector<T>& v, const vector<size_t>& perm) {
+        vector<T> nuevo;
+        nuevo.reserve(v.size());
+        for (size_t i : perm) nuevo.push_back(move(v[i]));
+        v.swap(nuevo);
+    }
+
+private:
+    // Orden total de los double como enteros sin signo: a los positivos se les
+    // enciende el bit de signo; a los negativos se les invierten todos los bits.
+    static uint64_t clave_de(double d) {
+        uint64_t b;
+        memcpy(&b, &d, sizeof(b));
+        return (b & 0x8000000000000000ULL) ? ~b : (b | 0x8000000000000000ULL);
+    }
+
+    static double double_de(uint64_t k) {
+        uint64_t b = (k & 0x8000000000000000ULL) ? (k & 0x7FFFFFFFFFFFFFFFULL) : ~k;
+        double d;
+        memcpy(&d, &b, sizeof(d));
+        return d;
+    }
+
+    // Seis pasadas de 11 bits. Las cuentas de todas se sacan en un solo
+    // recorrido; una pasada en la que todos caen en el mismo cubo (por ejemplo
+    // los bits bajos de números enteros) se salta.
+    template <typename T, typename Clave>
+    static void radix(vector<T>& v, vector<T>& aux, Clave clave) {
+        const int BITS = 11, PASADAS = 6;
+        const uint64_t MASCARA = (1 << BITS) - 1;
+        vector<size_t> cuenta((size_t)PASADAS << BITS);
+        for (const T& x : v) {
+            uint64_t k = clave(x);
+            for (int p = 0; p < PASADAS; p++) cuenta[((size_t)p << BITS) + ((k >> (p * BITS)) & MASCARA)]++;
+        }
+        for (int p = 0; p < PASADAS; p++) {
+            size_t* c = &cuenta[(size_t)p << BITS];
+            int desplazamiento = p * BITS;
+            if (c[(clave(v[0]) >> desplazamiento) & MASCARA] == v.size()) continue;
+
+            size_t pos = 0;
+            for (size_t d = 0; d <= MASCARA; d++) { size_t t = c[d]; c[d] = pos; pos += t; }
+            for (T& x : v) aux[c[(clave(x) >> desplazamiento) & MASCARA]++] = move(x);
+            v.swap(aux);
+        }
+    }
+
+    template <typename T, typename Comp>
+    static void ordenar_paralelo(vector<T>& v, Comp comp) {
+        PoolHilos& pool = PoolHilos::instancia();
+        size_t n = v.size();
+        size_t partes = (size_t)pool.tamano();
+        // Dentro de un cada_paralelo el pool ya está ocupado: se ordena en este hilo
+        if (n < UMBRAL_PARALELO || partes < 2 || PoolHilos::en_hilo_del_pool()) {
+            stable_sort(v.begin(), v.end(), comp);
+            return;
+        }
+
+        size_t tramo = (n + partes - 1) / partes;
+        pool.para_cada_bloque(partes, 1, [&](size_t ini, size_t fin, int) {
+            for (size_t p = ini; p < fin; p++) {
+                size_t a = min(p * tramo, n), b = min(a + tramo, n);
+                stable_sort(v.begin() + a, v.begin() + b, comp);
+            }
+        });
+
+        vector<T> destino(n);
+        for (size_t ancho = tramo; ancho < n; ancho *= 2) {
+            size_t pares = (n + 2 * ancho - 1) / (2 * ancho);
+            pool.para_cada_bloque(pares, 1, [&](size_t ini, size_t fin, int) {
+                for (size_t p = ini; p < fin; p++) {
+                    size_t a = p * 2 * ancho, m = min(a + ancho, n), b = min(a + 2 * ancho, n);
+                    merge(make_move_iterator(v.begin() + a), make_move_iterator(v.begin() + m),
+                          make_move_iterator(v.begin() + m), make_move_iterator(v.begin() + b),
+                          destino.begin() + a, comp);
+                }
+            });
+            v.swap(destino);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef POOL_HILOS_HPP
+#define POOL_HILOS_HPP
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <exception>
+#include <utility>
+#include "HiloEjecucion.hpp"
+
+using namespace std;
+
+// --- POOL DE HILOS CON ROBO DE TRABAJO ---
+// Cada hilo tiene su propia cola de rangos [inicio, fin). El dueño saca bloques
+// por detrás; cuando se queda sin trabajo roba por delante de las colas vecinas.
+// Se crea una sola vez (perezosamente) y se reutiliza en todo el programa.
+// Los trabajadores ejecutan el script: su pila se reserva para
+// PROFUNDIDAD_AUXILIAR llamadas anidadas (ver HiloEjecucion.hpp).
+
+class PoolHilos {
+public:
+    using Trabajo = function<void(size_t inicio, size_t fin, int hilo)>;
+
+    static PoolHilos& instancia() {
+        static PoolHilos pool;
+        return pool;
+    }
+
+    // 0 si no se pudo crear ningún trabajador (quien llama trabaja en secuencia)
+    int tamano() const { return (int)hilos.size(); }
+
+    // true si el hilo actual es uno de los trabajadores del pool
+    static bool en_hilo_del_pool() { return indice_hilo() >= 0; }
+
+    // Reparte [0, total) en bloques de 'bloque' elementos y espera a que terminen.
+    // Si algún bloque lanza una excepción, se relanza aquí tras el cierre.
+    void para_cada_bloque(size_t total, size_t bloque, const Trabajo& trabajo) {
+        if (total == 0) return;
+        if (bloque == 0) bloque = 1;
+
+        lock_guard<mutex> llamada(m_llamada);
+        {
+            unique_lock<mutex> lk(m_estado);
+            size_t destino = 0;
+            for (size_t ini = 0; ini < total; ini += bloque) {
+                size_t fin = (ini + bloque < total) ? ini + bloque : total;
+                lock_guard<mutex> lc(colas[destino]->m);
+                colas[destino]->rangos.push_back({ini, fin});
+                destino = (destino + 1) % colas.size();
+            }
+            trabajo_actual = &trabajo;
+            error = nullptr;
+            activos = (int)hilos.size();
+            generacion++;
+        }
+        cv_trabajo.notify_all();
+
+        unique_lock<mutex> lk(m_estado);
+        cv_fin.wait(lk, [this]() { return activos == 0; });
+        trabajo_actual = nullptr;
+        if (error) {
+            exception_ptr e = error;
+            error = nullptr;
+            rethrow_exception(e);
+        }
+    }
+
+    ~PoolHilos() {
+        {
+            lock_guard<mutex> lk(m_estado);
+            cerrando = true;
+        }
+        cv_trabajo.notify_all();
+        hilos.clear(); // cada Lanzado espera a su hilo
+    }
+
+private:
+    struct Cola {
+        mutex m;
+        deque<pair<size_t, size_t>> rangos;
+    };
+
+    vector<unique_ptr<HiloEjecucion::Lanzado>> hilos;
+    vector<unique_ptr<Cola>> colas;
+    mutex m_llamada;
+    mutex m_estado;
+    condition_variable cv_trabajo, cv_fin;
+    const Trabajo* trabajo_actual = nullptr;
+    exception_ptr error;
+    unsigned long long generacion = 0;
+    int activos = 0;
+    bool cerrando = false;
+
+    static int& indice_hilo() {
+        static thread_local int indice = -1;
+        return indice;
+    }
+
+    PoolHilos() {
+        unsigned n = thread::hardware_concurrency();
+        if (n == 0) n = 2;
+        for (unsigned i = 0; i < n; i++) colas.push_back(unique_ptr<Cola>(new Cola()));
+        size_t bytes = HiloEjecucion::bytes_para(HiloEjecucion::PROFUNDIDAD_AUXILIAR);
+        for (unsigned i = 0; i < n; i++) {
+            unique_ptr<HiloEjecucion::Lanzado> h(new HiloEjecucion::Lanzado(bytes, [this, i]() { bucle_trabajador((int)i); }));
+            if (!h->iniciado()) break; // sin memoria para más pilas: se trabaja con los que haya
+            hilos.push_back(move(h));
+        }
+        colas.resize(hilos.size());
+    }
+
+    bool tomar_rango(int yo, pair<size_t, size_t>& rango) {
+        {
+            Cola& propia = *colas[yo];
+            lock_guard<mutex> lc(propia.m);
+            if (!propia.rangos.empty()) {
+                rango = propia.rangos.back();
+                propia.rangos.pop_back();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < colas.size(); k++) {
+            Cola& otra = *colas[(yo + k) % colas.size()];
+            lock_guard<mutex> lc(otra.m);
+            if (!otra.rangos.empty()) {
+                rango = otra.rangos.front();
+                otra.rangos.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void bucle_trabajador(int yo) {
+        indice_hilo() = yo;
+        unsigned long long vista = 0;
+        while (true) {
+            const Trabajo* trabajo;
+            {
+                unique_lock<mutex> lk(m_estado);
+                cv_trabajo.wait(lk, [&]() { return cerrando || generacion != vista; });
+                if (cerrando) return;
+                vista = generacion;
+                trabajo = trabajo_actual;
+            }
+
+            pair<size_t, size_t> rango;
+            while (tomar_rango(yo, rango)) {
+                try {
+                    (*trabajo)(rango.first, rango.second, yo);
+                } catch (...) {
+                    lock_guard<mutex> lk(m_estado);
+                    if (!error) error = current_exception();
+                }
+            }
+
+            lock_guard<mutex> lk(m_estado);
+            if (--activos == 0) cv_fin.notify_all();
+        }
+    }
+};
+
+#endif
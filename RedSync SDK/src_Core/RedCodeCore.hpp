@@ -6,6 +6,10 @@
 #include <map>
 #include <functional>
 #include <iostream>
+#include <cstdint>
+#include <stdexcept>
+#include <initializer_list>
+#include "MapaHash.hpp"
 
 using namespace std;
 
@@ -15,6 +19,26 @@ using namespace std;
 struct InfoFuncion {
     int linea_inicio;
     vector<string> parametros;
+    bool pura = false; // "funcion pura": el resultado se memoriza por argumentos
+};
+
+struct Contexto;
+
+// Parámetro de función que nombra una lista (ln, lt o mapa) del llamador: no se
+// copia, se apunta al frame dueño y al nombre que tiene allí.
+struct RefLista {
+    vector<Contexto>* pila = nullptr;
+    size_t marco = 0;
+    string nombre;
+};
+
+// Estado de un 'cada' sobre rango(...) o sobre una porción lista[a:b]
+struct IteradorBucle {
+    bool es_rango = false;
+    double inicio = 0.0, paso = 1.0; // rango
+    string lista;                     // porción: lista de origen
+    size_t desde = 0;                 // y posición de su primer elemento
+    size_t total = 0;
 };
 
 // 2. Estructura de la memoria (Contexto)
@@ -23,21 +47,101 @@ struct Contexto {
     map<string, string> vt;          // Variables de texto
     map<string, vector<double>> ln;  // Listas numéricas
     map<string, vector<string>> lt;  // Listas texto
+    map<string, MapaHash> mp;        // Mapas (clave -> número o texto)
     map<int, int> contadores_bucle;
+    map<int, IteradorBucle> iteradores_bucle;
+    map<string, RefLista> refs;      // Listas recibidas por referencia (parámetros)
+    const string* funcion = nullptr; // Función a la que pertenece el frame (nullptr: global)
+};
+
+// Error que aborta la ejecución entera (p. ej. recursión demasiado profunda).
+// ejecutar_bloque le pone la línea del .red donde se produjo; ejecutar_programa
+// lo muestra como [ERROR] y termina el script.
+struct ErrorRedSync : runtime_error {
+    int linea = 0;
+    explicit ErrorRedSync(const string& msg) : runtime_error(msg) {}
+};
+
+// 3. Forma compilada de un script (lo que main() prepara antes de ejecutar).
+//    Se puede compilar una vez y ejecutar muchas (ver RedSyncAPI.h).
+struct ProgramaCompilado {
+    vector<string> script;
+    vector<int> lineas_origen;
+    map<int, int> saltos;
+    map<string, InfoFuncion> funciones;
 };
 
+// Huella del texto de un script (FNV-1a 64). La usan la caché .redc y el servidor.
+inline uint64_t hash_fuente(const string& s) {
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : s) { h ^= c; h *= 1099511628211ULL; }
+    return h;
+}
+
 // --- DECLARACIONES EXTERNAS (PROMESAS) ---
 // Estas variables existen realmente en main.cpp, aquí solo las anunciamos.
 
 extern vector<string> script;
+extern vector<int> lineas_origen;   // Línea real del .red de cada instrucción (para mensajes)
 extern map<int, int> saltos;
 extern map<string, InfoFuncion> funciones;
-extern vector<Contexto> pila_memoria; 
+extern thread_local vector<Contexto> pila_memoria; // Cada hilo tiene su propia pila
 extern map<string, function<void(string)>> modulos_registrados;
 
+// --- MÓDULOS (API v2) ---
+// Cada comando declara qué recibe en cada posición. El núcleo separa los
+// argumentos una sola vez por línea y en cada llamada entrega valores ya
+// evaluados:
+//   EXPRESION  número (admite variables y operaciones)     -> num
+//   TEXTO      texto literal, variable o concatenación      -> txt
+//   VALOR      número o texto, según lo que resulte         -> es_texto, num, txt
+//              (un número llega también escrito en txt)
+//   DESTINO    nombre de la variable en la que escribir     -> txt
+//   LISTA      nombre de una lista o mapa                   -> txt
+// La función recibe tantos argumentos como se escribieron (como mucho los
+// declarados). modulos_registrados (el texto crudo de los argumentos) se
+// mantiene para módulos antiguos.
+enum class TipoParametro { EXPRESION, TEXTO, VALOR, DESTINO, LISTA };
+
+struct Argumento {
+    bool es_texto = false;
+    double num = 0.0;
+    string txt;
+};
+
+typedef void (*FuncionModulo)(const vector<Argumento>& args);
+extern void registrar_comando(const string& nombre, initializer_list<TipoParametro> tipos, FuncionModulo fn);
+// Variante con un puntero de datos que se pasa en cada llamada (módulos nativos)
+typedef void (*FuncionModuloDatos)(const vector<Argumento>& args, void* datos);
+extern void registrar_comando(const string& nombre, const vector<TipoParametro>& tipos, FuncionModuloDatos fn, void* datos);
+
 // Funciones clave para que los plugins escriban en memoria
 extern void set_vt(const string& nombre, const string& val, bool forzar_local = false);
 extern void set_vn(const string& nombre, double val, bool forzar_local = false);
+extern MapaHash* get_mp_ptr(const string& nombre);
+extern vector<double>* get_ln_ptr(const string& nombre); // nullptr si la lista no existe
+extern vector<string>* get_lt_ptr(const string& nombre);
+extern double evaluar_matematica(string expr);
+extern bool evaluar_condicion_maestra(string expr);
+extern vector<string> split_smart(string s, char delimiter); // respeta comillas y paréntesis
 extern void cargar_puente_web();
 
+// Salida de consola: mostrar y entrada pasan por aquí. Si destino_salida está
+// definido (uso como biblioteca) recibe el texto en lugar de cout.
+extern function<void(const string&)> destino_salida;
+extern void emitir_salida(const string& texto);
+extern function<bool(string&)> origen_entrada; // Igual para entrada(): si está vacío se lee de stdin
+
+// Compilación y ejecución (usadas por main y por la biblioteca)
+extern bool compilar_programa(istream& fuente, ProgramaCompilado& prog, string& error);
+extern void intercambiar_programa(ProgramaCompilado& prog); // lo activa (o lo devuelve) en los globales
+extern int ejecutar_programa(); // 0 si terminó bien, 1 si se abortó con un ErrorRedSync
+extern int profundidad_maxima;   // llamadas anidadas permitidas (--profundidad-max)
+extern int nivel_optimizacion; // se aplica al compilar; la caché .redc lo recuerda
+extern vector<string> rutas_modulos; // carpetas de módulos nativos (--modulos=CARPETA)
+extern size_t tamano_memo; // resultados guardados por cada funcion pura (--memo=N, 0 = sin memoria)
+extern uint64_t max_pasos;     // límites de cada ejecución, 0 = sin límite (ver Limites.hpp)
+extern double tiempo_maximo;   // segundos
+extern size_t memoria_maxima;  // bytes de variables
+
 #endif
\ No newline at end of file
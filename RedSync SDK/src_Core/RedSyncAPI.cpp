@@ -0,0 +1,159 @@
+/**
+ * REDSYNC - API de biblioteca (implementación)
+ * Un RedPrograma guarda el script ya compilado, las variables de entrada y
+ * el frame global de la última ejecución.
+ */
+
+#include "RedSyncAPI.h"
+#include "RedCodeCore.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <algorithm>
+#include <mutex>
+
+using namespace std;
+
+struct RedPrograma {
+    ProgramaCompilado prog;
+    Contexto entradas;
+    Contexto resultado;
+    RedSalidaFn salida = nullptr;
+    void* usuario_salida = nullptr;
+};
+
+// Los globales del intérprete (script, saltos...) son únicos: una ejecución a la vez
+static mutex mutex_api;
+
+static void copiar_error(const string& msg, char* error, size_t tam_error) {
+    if (!error || tam_error == 0) return;
+    size_t n = min(msg.size(), tam_error - 1);
+    memcpy(error, msg.data(), n);
+    error[n] = '\0';
+}
+
+static RedPrograma* compilar_desde(istream& fuente, char* error, size_t tam_error) {
+    RedPrograma* p = new RedPrograma();
+    string msg;
+    bool ok;
+    {
+        lock_guard<mutex> lk(mutex_api);
+        ok = compilar_programa(fuente, p->prog, msg);
+    }
+    if (!ok) {
+        copiar_error(msg, error, tam_error);
+        delete p;
+        return nullptr;
+    }
+    return p;
+}
+
+RedPrograma* red_compilar_archivo(const char* ruta, char* error, size_t tam_error) {
+    ifstream f(ruta);
+    if (!f.is_open()) {
+        copiar_error(string("No se pudo abrir '") + ruta + "'", error, tam_error);
+        return nullptr;
+    }
+    return compilar_desde(f, error, tam_error);
+}
+
+RedPrograma* red_compilar_texto(const char* codigo, char* error, size_t tam_error) {
+    istringstream fuente(codigo);
+    return compilar_desde(fuente, error, tam_error);
+}
+
+void red_liberar(RedPrograma* prog) {
+    delete prog;
+}
+
+void red_definir_numero(RedPrograma* prog, const char* nombre, double valor) {
+    prog->entradas.vn[nombre] = valor;
+}
+
+void red_definir_texto(RedPrograma* prog, const char* nombre, const char* valor) {
+    prog->entradas.vt[nombre] = valor;
+}
+
+void red_definir_lista_numeros(RedPrograma* prog, const char* nombre, const double* valores, size_t n) {
+    prog->entradas.ln[nombre].assign(valores, valores + n);
+}
+
+void red_definir_lista_textos(RedPrograma* prog, const char* nombre, const char* const* valores, size_t n) {
+    vector<string>& lista = prog->entradas.lt[nombre];
+    lista.clear();
+    for (size_t i = 0; i < n; i++) lista.push_back(valores[i]);
+}
+
+void red_limpiar_entradas(RedPrograma* prog) {
+    prog->entradas = Contexto();
+}
+
+void red_capturar_salida(RedPrograma* prog, RedSalidaFn fn, void* usuario) {
+    prog->salida = fn;
+    prog->usuario_salida = usuario;
+}
+
+void red_agregar_ruta_modulos(const char* carpeta) {
+    if (!carpeta) return;
+    lock_guard<mutex> lk(mutex_api);
+    rutas_modulos.push_back(carpeta);
+}
+
+void red_definir_limites(unsigned long long max_pasos_ejec, double segundos, size_t bytes) {
+    lock_guard<mutex> lk(mutex_api);
+    max_pasos = max_pasos_ejec;
+    tiempo_maximo = segundos > 0 ? segundos : 0.0;
+    memoria_maxima = bytes;
+}
+
+int red_ejecutar(RedPrograma* prog) {
+    lock_guard<mutex> lk(mutex_api);
+
+    function<void(const string&)> salida_anterior = destino_salida;
+    if (prog->salida) {
+        RedSalidaFn fn = prog->salida;
+        void* usuario = prog->usuario_salida;
+        destino_salida = [fn, usuario](const string& texto) { fn(texto.data(), texto.size(), usuario); };
+    }
+
+    intercambiar_programa(prog->prog);
+    pila_memoria.assign(1, prog->entradas);
+    int estado = ejecutar_programa();
+    prog->resultado = move(pila_memoria.front());
+    pila_memoria.clear();
+    intercambiar_programa(prog->prog);
+
+    destino_salida = salida_anterior;
+    return estado;
+}
+
+int red_leer_numero(RedPrograma* prog, const char* nombre, double* valor) {
+    auto it = prog->resultado.vn.find(nombre);
+    if (it == prog->resultado.vn.end()) return 0;
+    if (valor) *valor = it->second;
+    return 1;
+}
+
+const char* red_leer_texto(RedPrograma* prog, const char* nombre) {
+    auto it = prog->resultado.vt.find(nombre);
+    return (it == prog->resultado.vt.end()) ? nullptr : it->second.c_str();
+}
+
+size_t red_leer_lista_numeros(RedPrograma* prog, const char* nombre, const double** datos) {
+    auto it = prog->resultado.ln.find(nombre);
+    if (it == prog->resultado.ln.end()) return 0;
+    if (datos) *datos = it->second.data();
+    return it->second.size();
+}
+
+size_t red_tamano_lista_textos(RedPrograma* prog, const char* nombre) {
+    auto it = prog->resultado.lt.find(nombre);
+    return (it == prog->resultado.lt.end()) ? 0 : it->second.size();
+}
+
+const char* red_leer_lista_texto(RedPrograma* prog, const char* nombre, size_t indice) {
+    auto it = prog->resultado.lt.find(nombre);
+    if (it == prog->resultado.lt.end() || indice >= it->second.size()) return nullptr;
+    return it->second[indice].c_str();
+}
@@ -0,0 +1,77 @@
+/**
+ * REDSYNC - API de biblioteca
+ * Permite compilar un script una sola vez y ejecutarlo muchas veces desde
+ * otro programa (C o C++), sin lanzar RedCore.exe ni volver a leer el .red.
+ *
+ * Uso típico:
+ *   RedPrograma* p = red_compilar_archivo("reglas.red", err, sizeof(err));
+ *   red_definir_numero(p, "importe", 1500);
+ *   red_ejecutar(p);
+ *   red_leer_numero(p, "descuento", &descuento);
+ *   red_liberar(p);
+ *
+ * Las ejecuciones se serializan internamente (el intérprete usa tablas
+ * globales), así que una misma biblioteca puede usarse desde varios hilos.
+ */
+
+#ifndef REDSYNC_API_H
+#define REDSYNC_API_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct RedPrograma RedPrograma;
+
+// Recibe cada fragmento que el script imprime (mostrar, avisos de entrada...)
+typedef void (*RedSalidaFn)(const char* texto, size_t longitud, void* usuario);
+
+// --- COMPILAR ---
+// Devuelven NULL si hay error; el mensaje se copia en 'error' (puede ser NULL).
+RedPrograma* red_compilar_archivo(const char* ruta, char* error, size_t tam_error);
+RedPrograma* red_compilar_texto(const char* codigo, char* error, size_t tam_error);
+void red_liberar(RedPrograma* prog);
+
+// --- ENTRADAS (se copian al frame global antes de cada ejecución) ---
+void red_definir_numero(RedPrograma* prog, const char* nombre, double valor);
+void red_definir_texto(RedPrograma* prog, const char* nombre, const char* valor);
+void red_definir_lista_numeros(RedPrograma* prog, const char* nombre, const double* valores, size_t n);
+void red_definir_lista_textos(RedPrograma* prog, const char* nombre, const char* const* valores, size_t n);
+void red_limpiar_entradas(RedPrograma* prog);
+
+// --- SALIDA ---
+// Con fn == NULL la salida vuelve a la consola.
+void red_capturar_salida(RedPrograma* prog, RedSalidaFn fn, void* usuario);
+
+// --- MÓDULOS NATIVOS ---
+// Carpeta en la que importar("nombre") busca libredmod_nombre (ver
+// RedSyncModulo.h). Se consulta antes que REDSYNC_MODULOS; vale para todos los
+// programas.
+void red_agregar_ruta_modulos(const char* carpeta);
+
+// --- LÍMITES ---
+// Acotan cada ejecución (0 = sin límite): operaciones ejecutadas, segundos de
+// reloj y bytes que ocupan las variables. Al pasarse, red_ejecutar devuelve 1
+// con "[ERROR] Linea N: se supero ...". Valen para todos los programas.
+void red_definir_limites(unsigned long long max_pasos, double segundos, size_t bytes);
+
+// --- EJECUTAR ---
+// Devuelve 0 si el script terminó correctamente y 1 si se abortó (por ejemplo
+// por recursión demasiado profunda); el motivo se emite como "[ERROR] ...".
+int red_ejecutar(RedPrograma* prog);
+
+// --- RESULTADOS (variables globales tras la última ejecución) ---
+// Los punteros devueltos son válidos hasta la siguiente ejecución.
+int red_leer_numero(RedPrograma* prog, const char* nombre, double* valor); // 1 si existe
+const char* red_leer_texto(RedPrograma* prog, const char* nombre);         // NULL si no existe
+size_t red_leer_lista_numeros(RedPrograma* prog, const char* nombre, const double** datos);
+size_t red_tamano_lista_textos(RedPrograma* prog, const char* nombre);
+const char* red_leer_lista_texto(RedPrograma* prog, const char* nombre, size_t indice);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,94 @@
+/**
+ * REDSYNC - Módulos nativos
+ * Un módulo es una biblioteca compartida que el núcleo carga cuando un script
+ * hace importar("nombre") y "nombre" no es uno de los módulos incluidos:
+ *
+ *   Linux:   libredmod_nombre.so      Windows: redmod_nombre.dll
+ *   macOS:   libredmod_nombre.dylib
+ *
+ * Se busca, en este orden, en las carpetas dadas con --modulos=CARPETA (o
+ * red_agregar_ruta_modulos) y en las de la variable REDSYNC_MODULOS (separadas
+ * por ':' o, en Windows, por ';'). La carpeta actual solo si se indica (--modulos=.).
+ *
+ * La biblioteca exporta dos funciones C:
+ *
+ *   REDSYNC_EXPORTAR int redsync_modulo_version(void) { return REDSYNC_MODULO_VERSION; }
+ *   REDSYNC_EXPORTAR int redsync_modulo_iniciar(const RedAnfitrion* red) {
+ *       static const int tipos[] = { RED_DESTINO, RED_EXPRESION };
+ *       red->registrar_comando("iva.calcular", tipos, 2, calcular, NULL);
+ *       red->registrar_funcion("iva.tasa", tasa, NULL);
+ *       return 0; // distinto de 0: el módulo no se carga
+ *   }
+ *
+ * El núcleo compara la versión antes de llamar a iniciar. Se usa solo C para
+ * que el módulo no dependa del compilador ni de la biblioteca estándar con la
+ * que se construyó el núcleo.
+ */
+
+#ifndef REDSYNC_MODULO_H
+#define REDSYNC_MODULO_H
+
+#include <stddef.h>
+
+#ifdef _WIN32
+#define REDSYNC_EXPORTAR __declspec(dllexport)
+#else
+#define REDSYNC_EXPORTAR __attribute__((visibility("default")))
+#endif
+
+#define REDSYNC_MODULO_VERSION 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Tipo de cada argumento de un comando (el mismo significado que TipoParametro)
+enum {
+    RED_EXPRESION = 0, // número ya evaluado                   -> num
+    RED_TEXTO = 1,     // texto ya resuelto                     -> txt
+    RED_VALOR = 2,     // número o texto                        -> es_texto, num, txt
+    RED_DESTINO = 3,   // nombre de la variable en la que escribir -> txt
+    RED_LISTA = 4      // nombre de una lista o mapa            -> txt
+};
+
+typedef struct RedArgumento {
+    int es_texto;
+    double num;
+    const char* txt; // válido solo durante la llamada
+} RedArgumento;
+
+// Sentencia: iva.calcular(total, importe)
+typedef void (*RedComandoFn)(const RedArgumento* args, size_t n, void* usuario);
+// Función dentro de expresiones: vn t = iva.tasa(2) * 100. Los argumentos se
+// evalúan como números. Puede llamarse desde varios hilos a la vez (dentro de
+// un cada_paralelo), así que no debe tocar estado compartido sin protegerlo.
+typedef double (*RedFuncionFn)(const double* args, size_t n, void* usuario);
+
+// Lo que el núcleo ofrece al módulo. Los nombres de variables se resuelven
+// como en el script (el frame actual y los que lo contienen).
+typedef struct RedAnfitrion {
+    int version;
+    void (*registrar_comando)(const char* nombre, const int* tipos, size_t n_tipos, RedComandoFn fn, void* usuario);
+    void (*registrar_funcion)(const char* nombre, RedFuncionFn fn, void* usuario);
+
+    void (*definir_numero)(const char* nombre, double valor);
+    void (*definir_texto)(const char* nombre, const char* valor);
+    int (*leer_numero)(const char* nombre, double* valor); // 1 si existe
+    const char* (*leer_texto)(const char* nombre);         // NULL si no existe
+
+    // Datos de una lista ln (NULL si no existe). Válidos hasta que el script la cambie.
+    double* (*lista_numeros)(const char* nombre, size_t* n);
+    // Crea la lista si no existe y le da 'n' elementos
+    double* (*redimensionar_lista)(const char* nombre, size_t n);
+
+    void (*emitir)(const char* texto); // como mostrar, sin salto de línea
+} RedAnfitrion;
+
+typedef int (*RedModuloVersionFn)(void);
+typedef int (*RedModuloIniciarFn)(const RedAnfitrion* anfitrion);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef TRAZA_HPP
+#define TRAZA_HPP
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+extern vector<int> lineas_origen;
+
+// --- TRAZA DE EJECUCIÓN (--traza salida.json) ---
+// Registra en formato Trace Event (el que abren Perfetto y chrome://tracing)
+// un tramo por cada llamada a función, comando de módulo y espera de
+// entrada(), con su inicio, su duración, el hilo y la línea del script.
+// Los tramos van a un anillo de tamaño fijo reservado al activar la traza:
+// cada hilo toma su casilla con un fetch_add, sin cerrojos ni reservas de
+// memoria. Si se llena se pisan los más antiguos (el archivo indica cuántos
+// se perdieron). El archivo se escribe una vez, al terminar el proceso.
+
+class Traza {
+public:
+    enum Categoria : uint8_t { FUNCION, MODULO, ENTRADA };
+
+    static const size_t EVENTOS_POR_DEFECTO = 1 << 18;
+
+    static void activar(const string& ruta, size_t eventos = EVENTOS_POR_DEFECTO) {
+        Estado& e = estado();
+        size_t cap = 1;
+        while (cap < eventos) cap <<= 1;
+        e.anillo.assign(cap, Evento());
+        e.mascara = cap - 1;
+        e.ruta = ruta;
+        e.inicio = chrono::steady_clock::now();
+        e.activa = true;
+        atexit(volcar);
+    }
+
+    static bool activa() { return estado().activa; }
+
+    // ejecutar_desde la actualiza mientras la traza está activa
+    static int& pc_actual() { static thread_local int pc = -1; return pc; }
+
+    // Un tramo: se registra al destruirse (también si la ejecución se aborta)
+    class Tramo {
+    public:
+        Tramo(Categoria cat, const string& nombre) : activo(Traza::activa()) {
+            if (!activo) return;
+            categoria = cat;
+            this->nombre = &nombre;
+            pc = Traza::pc_actual();
+            linea = Traza::linea_actual();
+            inicio = Traza::ahora();
+        }
+        ~Tramo() {
+            if (!activo) return;
+            Traza::registrar(categoria, *nombre, linea, inicio, Traza::ahora());
+            Traza::pc_actual() = pc; // la línea que llamaba sigue en curso
+        }
+        Tramo(const Tramo&) = delete;
+        Tramo& operator=(const Tramo&) = delete;
+    private:
+        bool activo;
+        Categoria categoria = FUNCION;
+        const string* nombre = nullptr;
+        int pc = -1;
+        int linea = 0;
+        uint64_t inicio = 0;
+    };
+
+    static void volcar() {
+        Estado& e = estado();
+        if (!e.activa || e.volcada) return;
+        e.volcada = true;
+        ofstream f(e.ruta, ios::binary);
+        if (!f.is_open()) {
+            fprintf(stderr, "[ERROR] --traza: no se pudo escribir '%s'\n", e.ruta.c_str());
+            return;
+        }
+        uint64_t total = e.escritos.load();
+        uint64_t cap = e.anillo.size();
+        uint64_t desde = total > cap ? total - cap : 0;
+        static const char* const categorias[] = {"funcion", "modulo", "entrada"};
+
+        f << "{\"traceEvents\":[\n";
+        f << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"RedCore\"}}";
+        for (int h = 1; h <= e.hilos.load(); h++) {
+            f << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << h << ",\"args\":{\"name\":\""
+              << "hilo " << h << "\"}}";
+        }
+        char num[64];
+        for (uint64_t i = desde; i < total; i++) {
+            const Evento& ev = e.anillo[i & e.mascara];
+            f << ",\n{\"name\":\"" << escapar(ev.nombre) << "\",\"cat\":\"" << categorias[ev.categoria] << "\",\"ph\":\"X\"";
+            snprintf(num, sizeof(num), "%.3f", ev.inicio_ns / 1000.0);
+            f << ",\"ts\":" << num;
+            snprintf(num, sizeof(num), "%.3f", ev.duracion_ns / 1000.0);
+            f << ",\"dur\":" << num << ",\"pid\":1,\"tid\":" << ev.hilo << ",\"args\":{\"linea\":" << ev.linea << "}}";
+        }
+        f << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"eventos\":" << (total - desde)
+          << ",\"eventos_perdidos\":" << desde << "}}\n";
+    }
+
+private:
+    struct Evento {
+        uint64_t inicio_ns = 0;
+        uint64_t duracion_ns = 0;
+        int linea = 0;
+        int hilo = 0;
+        Categoria categoria = FUNCION;
+        char nombre[39] = "";
+    };
+
+    struct Estado {
+        bool activa = false;
+        bool volcada = false;
+        string ruta;
+        vector<Evento> anillo;
+        uint64_t mascara = 0;
+        atomic<uint64_t> escritos{0};
+        atomic<int> hilos{0};
+        chrono::steady_clock::time_point inicio;
+    };
+
+    static Estado& estado() { static Estado e; return e; }
+
+    static uint64_t ahora() {
+        return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - estado().inicio).count();
+    }
+
+    static int linea_actual() {
+        int pc = pc_actual();
+        return (pc >= 0 && pc < (int)lineas_origen.size()) ? lineas_origen[pc] : 0;
+    }
+
+    static int hilo_actual() {
+        static thread_local int id = 0;
+        if (id == 0) id = estado().hilos.fetch_add(1) + 1;
+        return id;
+    }
+
+    static void registrar(Categoria cat, const string& nombre, int linea, uint64_t inicio, uint64_t fin) {
+        Estado& e = estado();
+        Evento& ev = e.anillo[e.escritos.fetch_add(1, memory_order_relaxed) & e.mascara];
+        ev.inicio_ns = inicio;
+        ev.duracion_ns = fin - inicio;
+        ev.linea = linea;
+        ev.hilo = hilo_actual();
+        ev.categoria = cat;
+        size_t n = min(nombre.size(), sizeof(ev.nombre) - 1);
+        memcpy(ev.nombre, nombre.data(), n);
+        ev.nombre[n] = '\0';
+    }
+
+    static string escapar(const char* s) {
+        string r;
+        for (; *s; s++) {
+            unsigned char c = (unsigned char)*s;
+            if (c == '"' || c == '\\') { r += '\\'; r += (char)c; }
+            else if (c < 0x20) r += ' ';
+            else r += (char)c;
+        }
+        return r;
+    }
+};
+
+#endif
@@ -8,6 +8,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
 #include <sstream>
 #include <algorithm>
 #include <cmath>
@@ -18,6 +19,12 @@
 #include <functional>
 #include <thread>
 #include <chrono>
+#include <mutex>
+#include <limits>
+#include <list>
+#include <unordered_map>
+#include <new>
+#include <cstdlib>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -31,6 +38,21 @@
 #include "ModuloRandom.hpp"
 #include "ModuloArchivos.hpp"
 #include "ModuloWeb.hpp"
+#include "PoolHilos.hpp"
+#include "ModoServidor.hpp"
+#include "CacheCompilada.hpp"
+#include "KernelsSIMD.hpp"
+#include "Ordenamiento.hpp"
+#include "Optimizador.hpp"
+#include "HiloEjecucion.hpp"
+#include "ModulosNativos.hpp"
+#include "Instrucciones.hpp"
+#include "Limites.hpp"
+#include "Memoria.hpp"
+#include "Traza.hpp"
+#include "Muestreo.hpp"
+#include "Canal.hpp"
+#include "LectorEntrada.hpp"
 
 using namespace std;
 
@@ -40,22 +62,70 @@ struct ValorRetorno {
     string t = "";
     bool es_texto = false;
     bool activo = false; 
+    char lista = 0;        // 'n' o 't' si se retornó una lista
+    vector<double> ln;
+    vector<string> lt;
 };
 
 // --- GLOBALES (Definición Real) ---
 // Aquí reservamos la memoria real. RedCodeCore.hpp solo dice que existen (extern).
 vector<string> script;
+vector<int> lineas_origen;
 map<int, int> saltos;
 map<string, InfoFuncion> funciones; // Ahora InfoFuncion ya es reconocida gracias al include
-vector<Contexto> pila_memoria; 
+thread_local vector<Contexto> pila_memoria; 
 map<string, function<void(string)>> modulos_registrados;
+int nivel_optimizacion = 1; // -O0, -O1 (por defecto) o -O2; ver Optimizador.hpp
+int profundidad_maxima = 10000; // llamadas anidadas antes de abortar (--profundidad-max=N)
+vector<string> rutas_modulos; // antes que REDSYNC_MODULOS (ver ModulosNativos.hpp)
+size_t tamano_memo = 4096; // entradas por funcion pura (--memo=N)
+vector<Instruccion> instrucciones; // el script decodificado (ver Instrucciones.hpp)
+bool frecuencia_ops = false;
+uint64_t max_pasos = 0;       // --max-pasos=N (0 = sin límite); ver Limites.hpp
+double tiempo_maximo = 0.0;   // --tiempo-max=SEGUNDOS
+size_t memoria_maxima = 0;    // --memoria-max=MB, guardado en bytes
+thread_local int profundidad_llamadas = 0;
+
+// Dentro de un cada_paralelo cada trabajador escribe en su propia pila y solo
+// LEE la pila del hilo principal a través de este puntero (nunca la modifica).
+thread_local const vector<Contexto>* pila_padre = nullptr;
+thread_local bool en_tarea = false; // el hilo ejecuta una 'tarea' (ver TAREAS)
+mutex mutex_salida; // Evita que dos hilos mezclen sus líneas en consola
+function<void(const string&)> destino_salida; // Si está vacío, la salida va a cout
+
+// Toda la salida del script pasa por aquí (mostrar, errores, módulos), desde
+// cualquier hilo: destino_salida puede escribir en un búfer compartido
+void emitir_salida(const string& texto) {
+    lock_guard<mutex> lk(mutex_salida);
+    if (destino_salida) destino_salida(texto);
+    else cout << texto << flush;
+}
+
+function<bool(string&)> origen_entrada; // Si está vacío, entrada() lee de stdin (LectorEntrada.hpp)
+
+bool leer_entrada(string& linea) {
+    if (!origen_entrada) return LectorEntrada::linea(linea); // el lector registra sus esperas
+    static const string nombre_traza = "entrada";
+    Traza::Tramo tramo(Traza::ENTRADA, nombre_traza);
+    return origen_entrada(linea);
+}
 
 // --- PROTOTIPOS ---
 double evaluar_matematica(string expr);
 string obtener_texto(string t);
 string obtener_texto_simple(string t); 
 ValorRetorno ejecutar_bloque(int pc_start, int pc_end = -1);
-ValorRetorno invocar_funcion_generica(string nombre, vector<string> args_raw);
+ValorRetorno ejecutar_desde(int& pc, int pc_end);
+ValorRetorno esperar_tarea(int id);
+bool hay_tareas_pendientes();
+double recibir_de_canal(const vector<string>& args);
+void cerrar_todos_los_canales();
+ValorRetorno invocar_funcion_generica(const string& nombre, const vector<string>& args_raw);
+ValorMapa evaluar_valor_mapa(const string& arg);
+size_t buscar_operador(const string& s, const string& op);
+size_t cierre_parentesis(const string& s, size_t abre);
+string texto_lista(const vector<double>& l);
+string texto_lista(const vector<string>& l);
 
 // --- HERRAMIENTAS (UTILS) ---
 
@@ -102,20 +172,96 @@ vector<string> split_smart(string s, char delimiter) {
 // --- GESTIÓN DE MEMORIA (SCOPE DINÁMICO) ---
 // NOTA: set_vt y set_vn se definen aquí, y RedCodeCore.hpp permite que los plugins las vean.
 
-double get_vn(const string& nombre) {
-    if (pila_memoria.empty()) return 0.0;
-    for (auto it = pila_memoria.rbegin(); it != pila_memoria.rend(); ++it) {
-        if (it->vn.count(nombre)) return it->vn.at(nombre);
+// Variable propia del frame o, para listas, parámetro recibido por referencia
+template <typename T, typename Campo>
+T* buscar_en_marco(const Contexto& marco, const string& nombre, Campo campo, bool con_referencias) {
+    auto& m = marco.*campo;
+    auto f = m.find(nombre);
+    if (f != m.end()) return const_cast<T*>(&f->second);
+    if (con_referencias && !marco.refs.empty()) {
+        auto r = marco.refs.find(nombre);
+        if (r != marco.refs.end()) {
+            auto& dueno = (*r->second.pila)[r->second.marco].*campo;
+            auto d = dueno.find(r->second.nombre);
+            if (d != dueno.end()) return const_cast<T*>(&d->second);
+        }
     }
-    return 0.0;
+    return nullptr;
 }
 
-string get_vt(const string& nombre) {
-    if (pila_memoria.empty()) return "";
+// Búsqueda desde el frame más reciente hacia el global; si estamos en un
+// trabajador de cada_paralelo se continúa por la pila (de solo lectura) del padre.
+template <typename T, typename Campo>
+T* buscar_en_pilas(const string& nombre, Campo campo, bool con_referencias = false) {
     for (auto it = pila_memoria.rbegin(); it != pila_memoria.rend(); ++it) {
-        if (it->vt.count(nombre)) return it->vt.at(nombre);
+        T* v = buscar_en_marco<T>(*it, nombre, campo, con_referencias);
+        if (v) return v;
     }
-    return "";
+    if (pila_padre) {
+        for (auto it = pila_padre->rbegin(); it != pila_padre->rend(); ++it) {
+            T* v = buscar_en_marco<T>(*it, nombre, campo, con_referencias);
+            if (v) return v;
+        }
+    }
+    return nullptr;
+}
+
+const double* buscar_vn(const string& nombre) { return buscar_en_pilas<double>(nombre, &Contexto::vn); }
+const string* buscar_vt(const string& nombre) { return buscar_en_pilas<string>(nombre, &Contexto::vt); }
+
+// Solo un nombre simple puede ser una variable o una lista (no "n - 1" ni "f(x)")
+bool es_nombre_simple(const string& s) {
+    if (s.empty() || isdigit((unsigned char)s[0])) return false;
+    for (char c : s) if (!isalnum((unsigned char)c) && c != '_') return false;
+    return true;
+}
+
+// true si lo visible con ese nombre es una variable de texto. Se detiene en el
+// primer frame que lo tenga con cualquier tipo: en una recursión profunda un
+// parámetro numérico no obliga a recorrer toda la pila buscando un texto.
+bool es_texto_visible(const string& nombre) {
+    if (!es_nombre_simple(nombre)) return false;
+    auto mirar = [&](const vector<Contexto>& pila, int& res) {
+        for (auto it = pila.rbegin(); it != pila.rend(); ++it) {
+            if (it->vt.count(nombre)) { res = 1; return; }
+            if (it->vn.count(nombre) || it->ln.count(nombre) || it->lt.count(nombre) ||
+                it->mp.count(nombre) || it->refs.count(nombre)) { res = 0; return; }
+        }
+    };
+    int res = -1;
+    mirar(pila_memoria, res);
+    if (res < 0 && pila_padre) mirar(*pila_padre, res);
+    return res == 1;
+}
+
+// La variable numérica que ve una línea, con la regla de es_texto_visible:
+// manda el primer frame que tenga el nombre. nullptr si allí es texto o lista,
+// o si no existe. Con 'escribible' no se mira la pila del padre (de solo
+// lectura en cada_paralelo).
+double* vn_visible(const string& nombre, bool escribible) {
+    auto mirar = [&](const vector<Contexto>& pila, double*& res) {
+        for (auto it = pila.rbegin(); it != pila.rend(); ++it) {
+            if (!it->vt.empty() && it->vt.count(nombre)) return true;
+            auto f = it->vn.find(nombre);
+            if (f != it->vn.end()) { res = const_cast<double*>(&f->second); return true; }
+            if ((!it->ln.empty() && it->ln.count(nombre)) || (!it->lt.empty() && it->lt.count(nombre)) ||
+                (!it->mp.empty() && it->mp.count(nombre)) || (!it->refs.empty() && it->refs.count(nombre))) return true;
+        }
+        return false;
+    };
+    double* res = nullptr;
+    if (!mirar(pila_memoria, res) && !escribible && pila_padre) mirar(*pila_padre, res);
+    return res;
+}
+
+double get_vn(const string& nombre) {
+    const double* v = buscar_vn(nombre);
+    return v ? *v : 0.0;
+}
+
+string get_vt(const string& nombre) {
+    const string* v = buscar_vt(nombre);
+    return v ? *v : "";
 }
 
 void set_vn(const string& nombre, double val, bool forzar_local) {
@@ -137,14 +283,35 @@ void set_vt(const string& nombre, const string& val, bool forzar_local) {
 }
 
 vector<double>* get_ln_ptr(const string& nombre) {
-    for (auto it = pila_memoria.rbegin(); it != pila_memoria.rend(); ++it) 
-        if (it->ln.count(nombre)) return &it->ln.at(nombre);
-    return nullptr;
+    return buscar_en_pilas<vector<double>>(nombre, &Contexto::ln, true);
 }
 vector<string>* get_lt_ptr(const string& nombre) {
-    for (auto it = pila_memoria.rbegin(); it != pila_memoria.rend(); ++it) 
-        if (it->lt.count(nombre)) return &it->lt.at(nombre);
-    return nullptr;
+    return buscar_en_pilas<vector<string>>(nombre, &Contexto::lt, true);
+}
+MapaHash* get_mp_ptr(const string& nombre) {
+    return buscar_en_pilas<MapaHash>(nombre, &Contexto::mp, true);
+}
+
+// Frame dueño de la lista (ln, lt o mapa) visible con ese nombre. Si el nombre
+// es a su vez un parámetro por referencia, se devuelve el dueño original.
+bool localizar_lista(const string& nombre, RefLista& ref) {
+    auto buscar = [&](vector<Contexto>& pila) {
+        for (size_t i = pila.size(); i-- > 0;) {
+            const Contexto& c = pila[i];
+            if (c.ln.count(nombre) || c.lt.count(nombre) || c.mp.count(nombre)) {
+                ref.pila = &pila;
+                ref.marco = i;
+                ref.nombre = nombre;
+                return true;
+            }
+            auto r = c.refs.find(nombre);
+            if (r != c.refs.end()) { ref = r->second; return true; }
+            if (c.vn.count(nombre) || c.vt.count(nombre)) return false; // la tapa un escalar
+        }
+        return false;
+    };
+    if (buscar(pila_memoria)) return true;
+    return pila_padre && buscar(*const_cast<vector<Contexto>*>(pila_padre));
 }
 
 // --- CORE MATEMÁTICO ---
@@ -166,38 +333,509 @@ int prec_mat(const string& op) {
     return 0;
 }
 
+// --- RANGOS Y PORCIONES (VISTAS SIN COPIA) ---
+// rango(fin), rango(inicio, fin), rango(inicio, fin, paso): de inicio a fin sin
+// incluirlo. No guarda nada; cada elemento se calcula cuando se pide.
+// lista[a:b]: los elementos a..b-1 de una lista existente, sin copiarlos. Si se
+// omite a o b se va desde el principio o hasta el final; los negativos cuentan
+// desde el final (datos[-3:] son los tres últimos).
+
+const size_t BLOQUE_VISTA = 256;
+
+struct VistaNumerica {
+    bool es_rango = false;
+    const double* datos = nullptr;   // porción de una ln
+    double inicio = 0.0, paso = 1.0; // rango: elemento i = inicio + i * paso
+    size_t n = 0;
+
+    double operator[](size_t i) const { return es_rango ? inicio + (double)i * paso : datos[i]; }
+};
+
+struct VistaTexto {
+    const string* datos = nullptr;
+    size_t n = 0;
+};
+
+bool parsear_rango(const string& expr, double& inicio, double& paso, size_t& n) {
+    string e = trim(expr);
+    if (e.compare(0, 6, "rango(") != 0 || e.back() != ')') return false;
+    vector<string> args = split_smart(e.substr(6, e.size() - 7), ',');
+    if (args.empty() || args.size() > 3 || trim(args[0]).empty()) return false;
+    double fin;
+    inicio = 0.0;
+    paso = 1.0;
+    if (args.size() == 1) fin = evaluar_matematica(args[0]);
+    else { inicio = evaluar_matematica(args[0]); fin = evaluar_matematica(args[1]); }
+    if (args.size() == 3) paso = evaluar_matematica(args[2]);
+    double pasos = (paso != 0.0) ? ceil((fin - inicio) / paso) : 0.0;
+    n = (pasos > 0.0) ? (size_t)pasos : 0;
+    return true;
+}
+
+// "datos[2:5]" -> "datos", "2", "5"
+bool partes_porcion(const string& expr, string& nombre, string& desde, string& hasta) {
+    string e = trim(expr);
+    size_t b1 = e.find('[');
+    if (b1 == string::npos || b1 == 0 || e.back() != ']') return false;
+    string interior = e.substr(b1 + 1, e.size() - b1 - 2);
+    size_t dos_puntos = buscar_operador(interior, ":");
+    if (dos_puntos == string::npos) return false;
+    nombre = trim(e.substr(0, b1));
+    desde = interior.substr(0, dos_puntos);
+    hasta = interior.substr(dos_puntos + 1);
+    return true;
+}
+
+void limites_porcion(const string& desde, const string& hasta, size_t tam, size_t& ini, size_t& fin) {
+    auto limite = [tam](const string& expr, size_t por_defecto) {
+        if (trim(expr).empty()) return por_defecto;
+        double v = evaluar_matematica(expr);
+        if (v < 0) v += (double)tam;
+        return (size_t)max(0.0, min((double)tam, v));
+    };
+    ini = limite(desde, 0);
+    fin = max(ini, limite(hasta, tam));
+}
+
+// Lista ln completa, porción de una ln o rango(...)
+bool vista_numerica(const string& expr, VistaNumerica& v) {
+    v = VistaNumerica();
+    if (parsear_rango(expr, v.inicio, v.paso, v.n)) { v.es_rango = true; return true; }
+    string t = trim(expr);
+    vector<double>* l = get_ln_ptr(t);
+    if (l) { v.datos = l->data(); v.n = l->size(); return true; }
+
+    string nombre, desde, hasta;
+    if (!partes_porcion(t, nombre, desde, hasta) || !get_ln_ptr(nombre)) return false;
+    size_t ini, fin;
+    limites_porcion(desde, hasta, get_ln_ptr(nombre)->size(), ini, fin);
+    l = get_ln_ptr(nombre); // los límites pueden haber llamado a funciones
+    fin = min(fin, l->size());
+    ini = min(ini, fin);
+    v.datos = l->data() + ini;
+    v.n = fin - ini;
+    return true;
+}
+
+bool vista_texto(const string& expr, VistaTexto& v) {
+    v = VistaTexto();
+    string t = trim(expr);
+    vector<string>* l = get_lt_ptr(t);
+    if (l) { v.datos = l->data(); v.n = l->size(); return true; }
+
+    string nombre, desde, hasta;
+    if (!partes_porcion(t, nombre, desde, hasta) || !get_lt_ptr(nombre)) return false;
+    size_t ini, fin;
+    limites_porcion(desde, hasta, get_lt_ptr(nombre)->size(), ini, fin);
+    l = get_lt_ptr(nombre);
+    fin = min(fin, l->size());
+    ini = min(ini, fin);
+    v.datos = l->data() + ini;
+    v.n = fin - ini;
+    return true;
+}
+
+// Elementos [ini, ini + largo) contiguos: directos de la lista, o generados en 'tmp' si es un rango
+const double* bloque_vista(const VistaNumerica& v, size_t ini, size_t largo, double* tmp) {
+    if (!v.es_rango) return v.datos + ini;
+    for (size_t k = 0; k < largo; k++) tmp[k] = v.inicio + (double)(ini + k) * v.paso;
+    return tmp;
+}
+
+// Llama a f(datos, largo) por tramos; una porción va entera de una vez
+template <typename F>
+void por_bloques(const VistaNumerica& v, F f) {
+    if (!v.es_rango) { if (v.n > 0) f(v.datos, v.n); return; }
+    double tmp[BLOQUE_VISTA];
+    for (size_t ini = 0; ini < v.n; ini += BLOQUE_VISTA) {
+        size_t largo = min(BLOQUE_VISTA, v.n - ini);
+        f(bloque_vista(v, ini, largo, tmp), largo);
+    }
+}
+
+vector<double> materializar(const VistaNumerica& v) {
+    vector<double> r(v.n);
+    for (size_t i = 0; i < v.n; i++) r[i] = v[i];
+    return r;
+}
+
+// --- FUNCIONES NATIVAS (ESTADÍSTICA SOBRE LISTAS) ---
+// Se pueden usar dentro de cualquier expresión: vn m = promedio(notas).
+// Aceptan listas, porciones (notas[0:10]) y rangos (suma(rango(1, 101))).
+// Una función del script con el mismo nombre tiene prioridad.
+
+bool vista_argumento(const vector<string>& args, size_t i, VistaNumerica& v) {
+    return i < args.size() && vista_numerica(args[i], v);
+}
+
+double suma_vista(const VistaNumerica& v) {
+    double s = 0.0;
+    por_bloques(v, [&](const double* d, size_t n) { s += KernelsSIMD::suma(d, n); });
+    return s;
+}
+
+double extremo_vista(const VistaNumerica& v, bool es_max) {
+    if (v.n == 0) return 0.0;
+    double r = v[0];
+    por_bloques(v, [&](const double* d, size_t n) {
+        r = es_max ? max(r, KernelsSIMD::maximo(d, n)) : min(r, KernelsSIMD::minimo(d, n));
+    });
+    return r;
+}
+
+double percentil_lista(vector<double> copia, double p) {
+    if (copia.empty()) return 0.0;
+    double pos = max(0.0, min(100.0, p)) / 100.0 * (copia.size() - 1);
+    size_t k = (size_t)pos;
+    nth_element(copia.begin(), copia.begin() + k, copia.end());
+    double bajo = copia[k];
+    if (k + 1 >= copia.size() || pos == (double)k) return bajo;
+    double alto = *min_element(copia.begin() + k + 1, copia.end());
+    return bajo + (alto - bajo) * (pos - k);
+}
+
+map<string, function<double(const vector<string>&)>> funciones_nativas = {
+    {"esperar", [](const vector<string>& a) { // vn r = esperar(t): el número que retornó la tarea
+        if (a.empty() || trim(a[0]).empty()) throw ErrorRedSync("esperar: falta la tarea");
+        return esperar_tarea((int)evaluar_matematica(a[0])).n;
+    }},
+    {"recibir", recibir_de_canal}, // mientras (recibir(c, x) == 1)
+    {"numero", [](const vector<string>& a) { // numero(fila[2]): texto a número, 0 si no lo es
+        return a.empty() ? 0.0 : LectorEntrada::a_numero(obtener_texto(a[0]));
+    }},
+    {"suma", [](const vector<string>& a) {
+        VistaNumerica v;
+        return vista_argumento(a, 0, v) ? suma_vista(v) : 0.0;
+    }},
+    {"promedio", [](const vector<string>& a) {
+        VistaNumerica v;
+        return (vista_argumento(a, 0, v) && v.n > 0) ? suma_vista(v) / v.n : 0.0;
+    }},
+    {"minimo", [](const vector<string>& a) {
+        VistaNumerica v;
+        return vista_argumento(a, 0, v) ? extremo_vista(v, false) : 0.0;
+    }},
+    {"maximo", [](const vector<string>& a) {
+        VistaNumerica v;
+        return vista_argumento(a, 0, v) ? extremo_vista(v, true) : 0.0;
+    }},
+    {"desviacion", [](const vector<string>& a) { // desviación estándar poblacional
+        VistaNumerica v;
+        if (!vista_argumento(a, 0, v) || v.n == 0) return 0.0;
+        double media = suma_vista(v) / v.n;
+        double s = 0.0;
+        por_bloques(v, [&](const double* d, size_t n) { s += KernelsSIMD::suma_desviaciones(d, n, media); });
+        return sqrt(s / v.n);
+    }},
+    {"producto_punto", [](const vector<string>& a) {
+        VistaNumerica x, y;
+        if (!vista_argumento(a, 0, x) || !vista_argumento(a, 1, y)) return 0.0;
+        size_t n = min(x.n, y.n);
+        if (!x.es_rango && !y.es_rango) return KernelsSIMD::producto_punto(x.datos, y.datos, n);
+        double tx[BLOQUE_VISTA], ty[BLOQUE_VISTA], s = 0.0;
+        for (size_t ini = 0; ini < n; ini += BLOQUE_VISTA) {
+            size_t largo = min(BLOQUE_VISTA, n - ini);
+            s += KernelsSIMD::producto_punto(bloque_vista(x, ini, largo, tx), bloque_vista(y, ini, largo, ty), largo);
+        }
+        return s;
+    }},
+    {"contar_si", [](const vector<string>& a) { // contar_si(lista, ">", 10)
+        VistaNumerica v;
+        if (!vista_argumento(a, 0, v) || a.size() < 3) return 0.0;
+        string op = obtener_texto(a[1]);
+        KernelsSIMD::Comparacion c;
+        if (op == ">") c = KernelsSIMD::MAYOR;
+        else if (op == "<") c = KernelsSIMD::MENOR;
+        else if (op == ">=") c = KernelsSIMD::MAYOR_IGUAL;
+        else if (op == "<=") c = KernelsSIMD::MENOR_IGUAL;
+        else if (op == "==") c = KernelsSIMD::IGUAL;
+        else if (op == "!=") c = KernelsSIMD::DISTINTO;
+        else return 0.0;
+        double valor = evaluar_matematica(a[2]);
+        size_t cuenta = 0;
+        por_bloques(v, [&](const double* d, size_t n) { cuenta += KernelsSIMD::contar_si(d, n, c, valor); });
+        return (double)cuenta;
+    }},
+    {"percentil", [](const vector<string>& a) { // percentil(lista, 90)
+        VistaNumerica v;
+        return (vista_argumento(a, 0, v) && a.size() > 1) ? percentil_lista(materializar(v), evaluar_matematica(a[1])) : 0.0;
+    }},
+    {"mediana", [](const vector<string>& a) {
+        VistaNumerica v;
+        return vista_argumento(a, 0, v) ? percentil_lista(materializar(v), 50.0) : 0.0;
+    }},
+};
+
+// Posición del ')' que cierra el '(' de 'abre' (string::npos si no cierra)
+size_t cierre_parentesis(const string& s, size_t abre) {
+    int nivel = 0;
+    bool comillas = false;
+    for (size_t i = abre; i < s.size(); i++) {
+        if (s[i] == '"') comillas = !comillas;
+        else if (!comillas && s[i] == '(') nivel++;
+        else if (!comillas && s[i] == ')' && --nivel == 0) return i;
+    }
+    return string::npos;
+}
+
+// --- MAPAS ---
+// mapa precios = {"pan": 1.5, "leche": 0.9}
+// Sentencias: precios.poner("pan", 2), precios.eliminar("pan"), precios.limpiar()
+// En expresiones: precios.obtener("pan"), precios.obtener("sal", 0),
+// precios.contiene("pan") (1 o 0) y precios.tamano()
+
+// 'nombre' es lo que va antes del paréntesis ("precios.obtener"). Devuelve
+// false si no es una consulta sobre un mapa existente.
+bool consultar_mapa(const string& nombre, const string& args_interior, ValorMapa& res) {
+    size_t punto = nombre.find('.');
+    if (punto == string::npos) return false;
+    MapaHash* mp = get_mp_ptr(nombre.substr(0, punto));
+    if (!mp) return false;
+    string metodo = nombre.substr(punto + 1);
+    vector<string> args = split_smart(args_interior, ',');
+
+    res = ValorMapa();
+    if (metodo == "tamano") { res.num = (double)mp->tamano(); return true; }
+    if (args.empty() || trim(args[0]).empty()) return false;
+    string clave = obtener_texto(args[0]);
+
+    if (metodo == "contiene") { res.num = mp->contiene(clave) ? 1.0 : 0.0; return true; }
+    if (metodo == "obtener") {
+        const ValorMapa* v = mp->buscar(clave);
+        if (v) res = *v;
+        else if (args.size() > 1) res = evaluar_valor_mapa(args[1]);
+        return true;
+    }
+    return false;
+}
+
+// Mismo criterio que los argumentos de funciones: comillas o variable vt es
+// texto; una lectura de otro mapa conserva su tipo; lo demás es número.
+ValorMapa evaluar_valor_mapa(const string& arg) {
+    ValorMapa v;
+    string a = trim(arg);
+    size_t p = a.find('(');
+    if (p != string::npos && a.back() == ')') {
+        size_t cierre = cierre_parentesis(a, p);
+        if (cierre == a.size() - 1 && consultar_mapa(trim(a.substr(0, p)), a.substr(p + 1, cierre - p - 1), v)) return v;
+    }
+    if (!a.empty() && (a.front() == '"' || buscar_vt(a))) {
+        v.es_texto = true;
+        v.txt = obtener_texto(a);
+    }
+    else v.num = evaluar_matematica(a);
+    return v;
+}
+
+string mapa_a_texto(const MapaHash& m) {
+    stringstream ss; ss << "{";
+    bool primero = true;
+    for (size_t i = m.siguiente(0); i < m.capacidad(); i = m.siguiente(i + 1)) {
+        const MapaHash::Celda& c = m.celda(i);
+        ss << (primero ? "" : ", ") << "\"" << c.clave << "\": ";
+        if (c.valor.es_texto) ss << "\"" << c.valor.txt << "\"";
+        else ss << a_string_universal(c.valor.num);
+        primero = false;
+    }
+    ss << "}";
+    return ss.str();
+}
+
+// Parte "clave": valor respetando las comillas
+void declarar_mapa(const string& nombre, const string& literal) {
+    MapaHash nuevo;
+    size_t l1 = literal.find('{'), l2 = literal.find_last_of('}');
+    if (l1 != string::npos && l2 != string::npos && l2 > l1) {
+        for (const string& par : split_smart(literal.substr(l1 + 1, l2 - l1 - 1), ',')) {
+            size_t sep = buscar_operador(par, ":");
+            if (sep == string::npos) continue;
+            nuevo.poner(obtener_texto(par.substr(0, sep)), evaluar_valor_mapa(par.substr(sep + 1)));
+        }
+    }
+    pila_memoria.back().mp[nombre] = move(nuevo);
+}
+
 // --- FUNCIONES Y EVALUACIÓN ---
 
-ValorRetorno invocar_funcion_generica(string nombre, vector<string> args_raw) {
-    ValorRetorno ret_default;
-    if (!funciones.count(nombre)) return ret_default;
+// Frame de una llamada: los números y textos se evalúan en el frame del que
+// llama y las listas se enlazan por referencia. Con 'reemplaza_actual' (llamada
+// en cola) el frame actual va a desaparecer, así que sus listas propias se
+// mueven al nuevo en lugar de enlazarse.
+void preparar_marco(const InfoFuncion& info, const vector<string>& args_raw, Contexto& marco, bool reemplaza_actual) {
+    vector<pair<const string*, RefLista>> listas;
+    for (size_t i = 0; i < info.parametros.size() && i < args_raw.size(); i++) {
+        const string& param = info.parametros[i];
+        string arg = trim(args_raw[i]);
+        RefLista ref;
+        if (es_nombre_simple(arg) && localizar_lista(arg, ref)) {
+            listas.push_back({&param, ref}); // por referencia, sin copiar
+        }
+        else if (!arg.empty() && (arg.front() == '"' || (es_texto_visible(arg) && !get_vt(arg).empty()))) {
+            marco.vt[param] = obtener_texto(arg);
+        } else {
+            marco.vn[param] = evaluar_matematica(arg);
+        }
+    }
 
-    InfoFuncion info = funciones[nombre];
-    
-    vector<pair<string, string>> args_texto;
-    vector<pair<string, double>> args_num;
-
-    for (size_t i = 0; i < info.parametros.size(); i++) {
-        if (i < args_raw.size()) {
-            string arg = trim(args_raw[i]);
-            if (arg.front() == '"' || !get_vt(arg).empty()) {
-                args_texto.push_back({info.parametros[i], obtener_texto(arg)});
-            } else {
-                args_num.push_back({info.parametros[i], evaluar_matematica(arg)});
-            }
+    // Las listas se mueven al final: otro argumento aún podía leerlas
+    size_t actual = pila_memoria.size() - 1;
+    map<string, string> movidas; // nombre en el frame actual -> parámetro que la recibió
+    for (auto& l : listas) {
+        const string& param = *l.first;
+        RefLista& ref = l.second;
+        if (!reemplaza_actual || ref.pila != &pila_memoria || ref.marco != actual) {
+            marco.refs[param] = ref;
+            continue;
+        }
+        auto previa = movidas.find(ref.nombre);
+        if (previa != movidas.end()) { // la misma lista en dos parámetros
+            marco.refs[param] = RefLista{&pila_memoria, actual, previa->second};
+            continue;
+        }
+        Contexto& origen = pila_memoria[actual];
+        if (origen.ln.count(ref.nombre)) marco.ln[param] = move(origen.ln[ref.nombre]);
+        else if (origen.lt.count(ref.nombre)) marco.lt[param] = move(origen.lt[ref.nombre]);
+        else marco.mp[param] = move(origen.mp[ref.nombre]);
+        movidas[ref.nombre] = param;
+    }
+}
+
+// Las tareas, los hilos y los trabajadores de cada_paralelo tienen una pila
+// más pequeña que la del hilo del script (ver HiloEjecucion.hpp)
+inline bool en_hilo_auxiliar() {
+    return en_tarea || PoolHilos::en_hilo_del_pool();
+}
+
+// Entrada y salida de una llamada: controla la profundidad y deja la pila como
+// estaba aunque la ejecución se aborte con un ErrorRedSync.
+struct LlamadaActiva {
+    LlamadaActiva(const string& nombre, Contexto&& marco) {
+        if (profundidad_llamadas >= profundidad_maxima)
+            throw ErrorRedSync("se supero la profundidad maxima de llamadas (" + to_string(profundidad_maxima) +
+                               ") en '" + nombre + "'. Si la recursion es correcta, usa --profundidad-max=N");
+        if (profundidad_llamadas >= HiloEjecucion::PROFUNDIDAD_AUXILIAR && en_hilo_auxiliar())
+            throw ErrorRedSync("se supero la profundidad maxima de llamadas (" + to_string(HiloEjecucion::PROFUNDIDAD_AUXILIAR) +
+                               ") en '" + nombre + "' dentro de una tarea, un hilo o cada_paralelo");
+        profundidad_llamadas++;
+        pila_memoria.push_back(move(marco));
+        publicada = Muestreo::activo() && pila_padre == nullptr && !en_tarea;
+        if (publicada) Muestreo::entrar(pila_memoria.back().funcion);
+    }
+    ~LlamadaActiva() {
+        if (publicada) Muestreo::salir();
+        pila_memoria.pop_back();
+        profundidad_llamadas--;
+    }
+    bool publicada = false;
+};
+
+// --- MEMORIA DE FUNCIONES PURAS ---
+// Una "funcion pura" solo depende de sus argumentos, así que su resultado se
+// guarda por los valores ya evaluados de esos argumentos: fib(n) recursiva
+// pasa de exponencial a lineal. Cada función tiene su tabla, acotada a
+// tamano_memo entradas; al llenarse sale la usada hace más tiempo (LRU). Las
+// llamadas con listas como argumento y las que retornan listas no se guardan.
+
+struct MemoFuncion {
+    struct Entrada {
+        string clave;
+        ValorRetorno valor;
+    };
+    list<Entrada> lru; // la más reciente al principio
+    unordered_map<string, list<Entrada>::iterator> indice;
+    size_t aciertos = 0, fallos = 0, desalojos = 0;
+    mutex m; // cada_paralelo puede llamar a la misma función desde varios hilos
+
+    bool buscar(const string& clave, ValorRetorno& valor) {
+        lock_guard<mutex> lk(m);
+        auto it = indice.find(clave);
+        if (it == indice.end()) { fallos++; return false; }
+        aciertos++;
+        lru.splice(lru.begin(), lru, it->second);
+        valor = lru.front().valor;
+        return true;
+    }
+
+    void guardar(const string& clave, const ValorRetorno& valor) {
+        lock_guard<mutex> lk(m);
+        auto it = indice.find(clave);
+        if (it != indice.end()) { // otro hilo la calculó a la vez
+            lru.splice(lru.begin(), lru, it->second);
+            return;
+        }
+        lru.push_front({clave, valor});
+        indice[clave] = lru.begin();
+        while (lru.size() > tamano_memo) {
+            indice.erase(lru.back().clave);
+            lru.pop_back();
+            desalojos++;
+        }
+    }
+};
+
+map<string, MemoFuncion> memos; // se vacía al empezar cada ejecución
+mutex mutex_memos;
+
+MemoFuncion& memo_de(const string& nombre) {
+    lock_guard<mutex> lk(mutex_memos);
+    return memos[nombre]; // los nodos de un map no se mueven
+}
+
+// Clave con los valores de los parámetros, en orden y con su tipo. false si
+// algún argumento es una lista.
+bool clave_memo(const InfoFuncion& info, const Contexto& marco, string& clave) {
+    if (!marco.refs.empty() || !marco.ln.empty() || !marco.lt.empty() || !marco.mp.empty()) return false;
+    for (const string& p : info.parametros) {
+        auto t = marco.vt.find(p);
+        auto n = marco.vn.find(p);
+        if (t != marco.vt.end()) {
+            uint32_t largo = (uint32_t)t->second.size();
+            clave += 't';
+            clave.append((const char*)&largo, sizeof(largo));
+            clave += t->second;
         }
+        else if (n != marco.vn.end()) {
+            clave += 'n';
+            clave.append((const char*)&n->second, sizeof(double));
+        }
+        else clave += '-';
+    }
+    return true;
+}
+
+void informe_memo(ostream& salida) {
+    salida << "--- MEMORIA DE FUNCIONES PURAS ---" << endl;
+    for (auto& m : memos) {
+        size_t llamadas = m.second.aciertos + m.second.fallos;
+        salida << m.first << ": " << m.second.aciertos << " aciertos, " << m.second.fallos << " fallos";
+        if (llamadas) salida << " (" << fixed << setprecision(1) << 100.0 * m.second.aciertos / llamadas << "%)";
+        salida << ", " << m.second.lru.size() << " guardados, " << m.second.desalojos << " desalojos" << endl;
     }
+    salida.unsetf(ios::floatfield);
+}
+
+ValorRetorno invocar_funcion_generica(const string& nombre, const vector<string>& args_raw) {
+    auto it = funciones.find(nombre);
+    if (it == funciones.end()) return ValorRetorno();
+    const InfoFuncion& info = it->second;
+    Traza::Tramo tramo(Traza::FUNCION, it->first);
 
     Contexto nuevo_frame;
-    pila_memoria.push_back(nuevo_frame);
-    
-    for(const auto& p : args_texto) set_vt(p.first, p.second, true);
-    for(const auto& p : args_num) set_vn(p.first, p.second, true);
+    nuevo_frame.funcion = &it->first;
+    preparar_marco(info, args_raw, nuevo_frame, false);
+
+    MemoFuncion* memo = nullptr;
+    string clave;
+    if (info.pura && tamano_memo > 0 && clave_memo(info, nuevo_frame, clave)) {
+        memo = &memo_de(nombre);
+        ValorRetorno guardado;
+        if (memo->buscar(clave, guardado)) return guardado;
+    }
 
+    LlamadaActiva llamada(nombre, move(nuevo_frame));
     ValorRetorno resultado = ejecutar_bloque(info.linea_inicio);
-    
-    pila_memoria.pop_back();
     resultado.activo = false; 
+    if (memo && !resultado.lista) memo->guardar(clave, resultado);
     return resultado;
 }
 
@@ -216,6 +854,14 @@ double obtener_valor_numerico(string token) {
             ValorRetorno ret = invocar_funcion_generica(nombre, args);
             return ret.n; 
         }
+        auto nativa = funciones_nativas.find(nombre);
+        if (nativa != funciones_nativas.end()) {
+            string args_interior = token.substr(par_open + 1, par_close - par_open - 1);
+            return nativa->second(split_smart(args_interior, ','));
+        }
+        ValorMapa vm;
+        if (consultar_mapa(nombre, token.substr(par_open + 1, par_close - par_open - 1), vm))
+            return vm.es_texto ? atof(vm.txt.c_str()) : vm.num;
     }
 
     size_t bracket_open = token.find('[');
@@ -231,10 +877,13 @@ double obtener_valor_numerico(string token) {
         return 0.0;
     }
 
-    double val = get_vn(token);
-    if (val != 0.0) return val;
-    for (auto it = pila_memoria.rbegin(); it != pila_memoria.rend(); ++it) 
-        if (it->vn.count(token)) return it->vn.at(token);
+    // Un número no puede ser nombre de variable: no hace falta recorrer la pila
+    if (isdigit((unsigned char)token[0]) || token[0] == '.') {
+        try { return stod(token); } catch (...) { return 0.0; }
+    }
+
+    const double* val = buscar_vn(token);
+    if (val) return *val;
 
     try { return stod(token); } catch (...) { return 0.0; }
 }
@@ -344,6 +993,171 @@ double evaluar_matematica(string expr) {
     return vals.empty() ? 0.0 : vals.top();
 }
 
+// --- ARITMÉTICA ENTRE LISTAS ---
+// ln total = precios * cantidades + 5
+// Las listas 'ln', sus porciones (datos[1:]) y los rangos son operandos
+// vectoriales; cualquier otro término
+// (número, variable, maximo(datos), lista[0]...) se evalúa una vez y se repite
+// para todos los elementos. La expresión se pasa a postfijo y se recorre por
+// bloques de 256 elementos, de modo que los temporales caben en caché y el
+// último operador escribe directamente en la lista destino.
+
+struct NodoVectorial {
+    char op = 0;                   // 0 = operando; 'n' = negación
+    const double* base = nullptr;  // lista o bloque con el escalar repetido
+    bool avanza = false;           // true si es una lista (se desplaza por bloque)
+    double* generado = nullptr;    // rango: bloque que se rellena en cada tramo
+    double inicio = 0.0, paso = 1.0;
+};
+
+// Con 'declarar' la lista se crea en el frame actual (ln x = ...); si no, se
+// asigna a la lista visible con ese nombre (x = ...).
+bool evaluar_vectorial(const string& expr, const string& destino, bool declarar, string& error) {
+    const size_t BLOQUE = 256;
+    string limpia = "";
+    for (char c : expr) if (!isspace((unsigned char)c)) limpia += c;
+
+    vector<NodoVectorial> postfijo;
+    vector<char> ops;
+    vector<vector<double>> escalares; // bloques de los operandos escalares y de los rangos
+    escalares.reserve(limpia.size() + 1);
+    size_t n = 0;
+    bool hay_lista = false;
+    string nombre_lista_n;
+
+    auto escalar = [&](double v) {
+        escalares.emplace_back(BLOQUE, v);
+        NodoVectorial nodo;
+        nodo.base = escalares.back().data();
+        return nodo;
+    };
+    auto desapilar_op = [&]() { NodoVectorial nodo; nodo.op = ops.back(); ops.pop_back(); postfijo.push_back(nodo); };
+    auto prec = [](char op) { return op == 'n' ? 4 : prec_mat(string(1, op)); };
+
+    bool esperando_operando = true;
+    for (size_t i = 0; i < limpia.size(); i++) {
+        char c = limpia[i];
+        if (c == '(' && esperando_operando) { ops.push_back('('); continue; }
+        if (c == ')') {
+            while (!ops.empty() && ops.back() != '(') desapilar_op();
+            if (!ops.empty()) ops.pop_back();
+            esperando_operando = false;
+            continue;
+        }
+        if (c == '-' && esperando_operando) { ops.push_back('n'); continue; }
+        if (string("+-*/%^").find(c) != string::npos && !esperando_operando) {
+            char op = c;
+            if (c == '*' && i + 1 < limpia.size() && limpia[i + 1] == '*') { op = '^'; i++; }
+            while (!ops.empty() && ops.back() != '(' && prec(ops.back()) >= prec(op)) desapilar_op();
+            ops.push_back(op);
+            esperando_operando = true;
+            continue;
+        }
+
+        // Operando: hasta el siguiente operador fuera de paréntesis/corchetes
+        string token = "";
+        int par_bal = 0, brack_bal = 0;
+        while (i < limpia.size()) {
+            char nc = limpia[i];
+            if (nc == '(') par_bal++;
+            else if (nc == ')') { if (par_bal == 0) break; par_bal--; }
+            else if (nc == '[') brack_bal++;
+            else if (nc == ']') brack_bal--;
+            bool es_op = string("+-*/%^").find(nc) != string::npos;
+            if (es_op && par_bal == 0 && brack_bal == 0 && !((nc == '+' || nc == '-') && !token.empty() && tolower(token.back()) == 'e' && isdigit((unsigned char)token[0]))) break;
+            token += nc;
+            i++;
+        }
+        i--;
+
+        VistaNumerica vista;
+        if (vista_numerica(token, vista)) {
+            if (hay_lista && vista.n != n) {
+                error = "las listas tienen tamaños distintos ('" + nombre_lista_n + "': " + to_string(n) +
+                        ", '" + token + "': " + to_string(vista.n) + ")";
+                return false;
+            }
+            hay_lista = true;
+            n = vista.n;
+            nombre_lista_n = token;
+            NodoVectorial nodo;
+            nodo.avanza = true;
+            if (vista.es_rango) {
+                escalares.emplace_back(BLOQUE);
+                nodo.generado = escalares.back().data();
+                nodo.inicio = vista.inicio;
+                nodo.paso = vista.paso;
+            }
+            else nodo.base = vista.datos;
+            postfijo.push_back(nodo);
+        } else {
+            postfijo.push_back(escalar(obtener_valor_numerico(token)));
+        }
+        esperando_operando = false;
+    }
+    while (!ops.empty()) {
+        if (ops.back() == '(') ops.pop_back();
+        else desapilar_op();
+    }
+    if (!hay_lista) {
+        error = "la expresion no contiene ninguna lista numerica";
+        return false;
+    }
+
+    // Solo crece si el destino no es uno de los operandos (una porción del
+    // destino nunca es más larga que él), así que los punteros de arriba siguen
+    // siendo válidos; si encoge, se recorta al final para poder leer x[1:] en x.
+    vector<double>* dest = declarar ? nullptr : get_ln_ptr(destino);
+    if (!dest) dest = &pila_memoria.back().ln[destino];
+    if (dest->size() < n) dest->resize(n);
+
+    vector<double> menos_uno(BLOQUE, -1.0);
+    vector<vector<double>> temporales(postfijo.size(), vector<double>(BLOQUE));
+    vector<const double*> pila;
+    pila.reserve(postfijo.size());
+
+    for (size_t ini = 0; ini < n; ini += BLOQUE) {
+        size_t largo = min(BLOQUE, n - ini);
+        double* salida = dest->data() + ini;
+        pila.clear();
+        for (size_t k = 0; k < postfijo.size(); k++) {
+            const NodoVectorial& nodo = postfijo[k];
+            if (nodo.op == 0) {
+                if (nodo.generado) {
+                    for (size_t e = 0; e < largo; e++) nodo.generado[e] = nodo.inicio + (double)(ini + e) * nodo.paso;
+                    pila.push_back(nodo.generado);
+                }
+                else pila.push_back(nodo.avanza ? nodo.base + ini : nodo.base);
+                continue;
+            }
+            const double* b = (nodo.op == 'n') ? menos_uno.data() : pila.back();
+            if (nodo.op != 'n') pila.pop_back();
+            const double* a = pila.back();
+            pila.pop_back();
+            double* r = (k + 1 == postfijo.size()) ? salida : temporales[pila.size()].data();
+            KernelsSIMD::operar(nodo.op == 'n' ? '*' : nodo.op, a, b, r, largo);
+            pila.push_back(r);
+        }
+        if (!pila.empty() && pila.back() != salida) copy(pila.back(), pila.back() + largo, salida);
+    }
+    dest->resize(n);
+    return true;
+}
+
+string texto_lista(const vector<double>& l) {
+    stringstream ss; ss << "[";
+    for(size_t i = 0; i < l.size(); ++i) ss << a_string_universal(l[i]) << (i < l.size()-1 ? ", " : "");
+    ss << "]";
+    return ss.str();
+}
+
+string texto_lista(const vector<string>& l) {
+    stringstream ss; ss << "[";
+    for(size_t i = 0; i < l.size(); ++i) ss << "\"" << l[i] << "\"" << (i < l.size()-1 ? ", " : "");
+    ss << "]";
+    return ss.str();
+}
+
 string obtener_texto(string t) {
     t = trim(t);
     if (t.empty()) return "";
@@ -389,24 +1203,47 @@ string obtener_texto_simple(string t) {
              vector<string> args = split_smart(args_int, ',');
              if (args.size()==1 && trim(args[0]).empty()) args.clear();
              ValorRetorno ret = invocar_funcion_generica(nombre, args);
+             if (ret.lista == 'n') return texto_lista(ret.ln);
+             if (ret.lista == 't') return texto_lista(ret.lt);
              return ret.es_texto ? ret.t : a_string_universal(ret.n);
         }
+        auto nativa = funciones_nativas.find(nombre);
+        if (nativa != funciones_nativas.end()) {
+             string args_int = t.substr(par_open+1, t.size() - par_open - 2);
+             return a_string_universal(nativa->second(split_smart(args_int, ',')));
+        }
+        ValorMapa vm;
+        if (consultar_mapa(nombre, t.substr(par_open+1, t.size() - par_open - 2), vm))
+            return vm.es_texto ? vm.txt : a_string_universal(vm.num);
+    }
+
+    string nombre_p, desde_p, hasta_p;
+    if (t.compare(0, 6, "rango(") == 0 || partes_porcion(t, nombre_p, desde_p, hasta_p)) {
+        VistaNumerica vn_v;
+        VistaTexto vt_v;
+        stringstream ss; ss << "[";
+        if (vista_numerica(t, vn_v)) {
+            for (size_t i = 0; i < vn_v.n; ++i) ss << a_string_universal(vn_v[i]) << (i < vn_v.n-1 ? ", " : "");
+            ss << "]";
+            return ss.str();
+        }
+        if (vista_texto(t, vt_v)) {
+            for (size_t i = 0; i < vt_v.n; ++i) ss << "\"" << vt_v.datos[i] << "\"" << (i < vt_v.n-1 ? ", " : "");
+            ss << "]";
+            return ss.str();
+        }
     }
 
     vector<double>* ln = get_ln_ptr(t);
     if (ln) {
-        stringstream ss; ss << "[";
-        for(size_t i = 0; i < ln->size(); ++i) ss << a_string_universal((*ln)[i]) << (i < ln->size()-1 ? ", " : "");
-        ss << "]";
-        return ss.str();
+        return texto_lista(*ln);
     }
     vector<string>* lt = get_lt_ptr(t);
     if (lt) {
-        stringstream ss; ss << "[";
-        for(size_t i = 0; i < lt->size(); ++i) ss << "\"" << (*lt)[i] << "\"" << (i < lt->size()-1 ? ", " : "");
-        ss << "]";
-        return ss.str();
+        return texto_lista(*lt);
     }
+    MapaHash* mp = get_mp_ptr(t);
+    if (mp) return mapa_a_texto(*mp);
 
     size_t b_open = t.find('[');
     if (b_open != string::npos) {
@@ -421,8 +1258,8 @@ string obtener_texto_simple(string t) {
 
     string val_t = get_vt(t);
     if (!val_t.empty()) return val_t;
-    for(auto it = pila_memoria.rbegin(); it != pila_memoria.rend(); ++it) 
-        if(it->vn.count(t)) return a_string_universal(it->vn.at(t));
+    const double* val_n = buscar_vn(t);
+    if (val_n) return a_string_universal(*val_n);
     
     if (t.find_first_of("0123456789") != string::npos) {
          return a_string_universal(evaluar_matematica(t));
@@ -431,6 +1268,22 @@ string obtener_texto_simple(string t) {
     return t; 
 }
 
+// Posición de 'op' fuera de comillas y paréntesis (los argumentos de una
+// llamada como contar_si(l, ">", 3) no deben partir la comparación)
+size_t buscar_operador(const string& s, const string& op) {
+    bool comillas = false;
+    int nivel = 0;
+    for (size_t i = 0; i + op.size() <= s.size(); i++) {
+        char c = s[i];
+        if (c == '"') comillas = !comillas;
+        else if (comillas) continue;
+        else if (c == '(') nivel++;
+        else if (c == ')') nivel--;
+        else if (nivel == 0 && s.compare(i, op.size(), op) == 0) return i;
+    }
+    return string::npos;
+}
+
 bool evaluar_comparacion(string cond) {
     cond = trim(cond);
     string ops_c[] = {"==", "!=", ">=", "<=", ">", "<"};
@@ -438,7 +1291,7 @@ bool evaluar_comparacion(string cond) {
     size_t pos = string::npos;
     
     for (const string& o : ops_c) {
-        pos = cond.find(o);
+        pos = buscar_operador(cond, o);
         if (pos != string::npos) { op = o; break; }
     }
     
@@ -447,10 +1300,7 @@ bool evaluar_comparacion(string cond) {
     string lhs = trim(cond.substr(0, pos));
     string rhs = trim(cond.substr(pos + op.length()));
 
-    bool lhs_is_text = (lhs.front() == '"' || !get_vt(lhs).empty());
-    if (!lhs_is_text) {
-        for(auto it = pila_memoria.rbegin(); it != pila_memoria.rend(); ++it) if(it->vt.count(lhs)) lhs_is_text = true;
-    }
+    bool lhs_is_text = (lhs.front() == '"' || es_texto_visible(lhs));
 
     if (lhs_is_text) {
         string t1 = obtener_texto(lhs);
@@ -473,10 +1323,31 @@ bool evaluar_comparacion(string cond) {
 }
 
 bool evaluar_condicion_maestra(string expr) {
+    // Los paréntesis de agrupación se separan como tokens; los de una llamada
+    // (pegados a un nombre, p.ej. promedio(notas)) y el texto entre comillas se
+    // mantienen juntos: sus espacios se protegen con \x01 hasta el final.
     string l = ""; 
-    for (char c : expr) { 
-        if (c == '(') l += " ( "; 
-        else if (c == ')') l += " ) "; 
+    bool en_comillas = false;
+    int nivel_llamada = 0;
+    for (size_t i = 0; i < expr.size(); i++) { 
+        char c = expr[i];
+        if (c == '"') en_comillas = !en_comillas;
+        if (en_comillas || (nivel_llamada > 0 && c != '(' && c != ')')) {
+            l += (c == ' ') ? '\x01' : c;
+        }
+        else if (c == '(') {
+            size_t ini = i;
+            while (ini > 0 && (isalnum((unsigned char)expr[ini - 1]) || expr[ini - 1] == '_')) ini--;
+            string previa = expr.substr(ini, i - ini);
+            transform(previa.begin(), previa.end(), previa.begin(), ::toupper);
+            bool es_llamada = nivel_llamada > 0 || (!previa.empty() && previa != "Y" && previa != "O" && previa != "NO");
+            if (es_llamada) { nivel_llamada++; l += c; }
+            else l += " ( ";
+        }
+        else if (c == ')') {
+            if (nivel_llamada > 0) { nivel_llamada--; l += c; }
+            else l += " ) ";
+        }
         else l += c; 
     }
     
@@ -517,13 +1388,178 @@ bool evaluar_condicion_maestra(string expr) {
                 }
                 ops.push(up);
             }
-        } else { if (!buffer.empty()) buffer += " "; buffer += t; }
+        } else {
+            replace(t.begin(), t.end(), '\x01', ' ');
+            if (!buffer.empty()) buffer += " ";
+            buffer += t;
+        }
     }
     if (!buffer.empty()) vals.push(evaluar_comparacion(buffer));
     while (!ops.empty()) resolver();
     return vals.empty() ? false : vals.top();
 }
 
+// --- MÓDULOS (API v2) ---
+// registrar_comando guarda la firma de cada comando. Una línea que lo llama se
+// enlaza la primera vez que se ejecuta (los módulos se registran con importar,
+// en tiempo de ejecución): se resuelve la función y se precompila cada
+// argumento según su tipo. Las siguientes ejecuciones de la línea solo evalúan
+// lo que puede cambiar (variables y expresiones); los literales ya están listos.
+
+struct ComandoRegistrado {
+    vector<TipoParametro> tipos;
+    FuncionModulo fn = nullptr;
+    FuncionModuloDatos fn_datos = nullptr; // la usan los módulos nativos
+    void* datos = nullptr;
+};
+map<string, ComandoRegistrado> comandos_modulo;
+unsigned generacion_comandos = 1; // cambia con cada registro
+
+void registrar_comando(const string& nombre, initializer_list<TipoParametro> tipos, FuncionModulo fn) {
+    comandos_modulo[nombre] = {vector<TipoParametro>(tipos), fn, nullptr, nullptr};
+    generacion_comandos++;
+}
+
+void registrar_comando(const string& nombre, const vector<TipoParametro>& tipos, FuncionModuloDatos fn, void* datos) {
+    comandos_modulo[nombre] = {tipos, nullptr, fn, datos};
+    generacion_comandos++;
+}
+
+struct ArgumentoEnlazado {
+    enum Forma { CONSTANTE, NOMBRE, EXPRESION } forma = CONSTANTE;
+    TipoParametro tipo = TipoParametro::EXPRESION;
+    string texto; // nombre o expresión (NOMBRE / EXPRESION)
+};
+
+struct EnlaceModulo {
+    unsigned generacion = 0;     // generacion_comandos con la que se resolvió
+    const ComandoRegistrado* cmd = nullptr; // nullptr: la línea no es un comando v2
+    vector<ArgumentoEnlazado> args;
+    vector<Argumento> valores;   // las CONSTANTE se rellenan al enlazar
+};
+vector<EnlaceModulo> enlaces_modulo; // uno por instrucción; se reinicia con el programa
+unsigned programa_enlaces = 0;       // cambia cada vez que se reinicia enlaces_modulo
+
+// Los demás hilos (tareas, hilos y trabajadores de cada_paralelo) no tocan la
+// tabla compartida: cada uno tiene la suya, que se descarta al cambiar de programa
+struct EnlacesDelHilo {
+    unsigned programa = 0;
+    vector<EnlaceModulo> enlaces;
+};
+thread_local EnlacesDelHilo enlaces_del_hilo;
+
+bool comillas_fuera_de_llamadas(const string& s);
+
+bool es_numero_literal(const string& s, double& valor) {
+    if (s.empty()) return false;
+    char* fin = nullptr;
+    valor = strtod(s.c_str(), &fin);
+    return fin && *fin == '\0' && !isalpha((unsigned char)s[0]);
+}
+
+// Un texto: hay comillas o alguno de los sumandos es una variable de texto
+bool expresion_de_texto(const string& expr) {
+    if (comillas_fuera_de_llamadas(expr)) return true;
+    for (const string& parte : split_smart(expr, '+'))
+        if (es_texto_visible(trim(parte))) return true;
+    return false;
+}
+
+void precompilar_argumento(const string& raw, TipoParametro tipo, ArgumentoEnlazado& a, Argumento& v) {
+    string t = trim(raw);
+    bool entre_comillas = t.size() >= 2 && t.front() == '"' && t.back() == '"' && t.find('"', 1) == t.size() - 1;
+    string literal = entre_comillas ? t.substr(1, t.size() - 2) : t;
+    double num = 0;
+    a.tipo = tipo;
+    a.forma = ArgumentoEnlazado::CONSTANTE;
+
+    switch (tipo) {
+        case TipoParametro::DESTINO:
+        case TipoParametro::LISTA:
+            // Se aceptan "nombre" y nombre; fuera queda lo que no puede ser un nombre
+            for (char c : literal) if (isalnum((unsigned char)c) || c == '_') v.txt += c;
+            break;
+        case TipoParametro::EXPRESION:
+            if (es_numero_literal(literal, num)) v.num = num;
+            else { a.forma = ArgumentoEnlazado::EXPRESION; a.texto = literal; }
+            break;
+        case TipoParametro::TEXTO:
+            if (entre_comillas || es_numero_literal(t, num)) v.txt = literal;
+            else if (es_nombre_simple(t)) { a.forma = ArgumentoEnlazado::NOMBRE; a.texto = t; }
+            else { a.forma = ArgumentoEnlazado::EXPRESION; a.texto = t; }
+            break;
+        case TipoParametro::VALOR:
+            if (entre_comillas) { v.es_texto = true; v.txt = literal; }
+            else if (es_numero_literal(t, num)) { v.num = num; v.txt = a_string_universal(num); }
+            else if (es_nombre_simple(t)) { a.forma = ArgumentoEnlazado::NOMBRE; a.texto = t; }
+            else { a.forma = ArgumentoEnlazado::EXPRESION; a.texto = t; }
+            break;
+    }
+}
+
+void evaluar_argumento(const ArgumentoEnlazado& a, Argumento& v) {
+    if (a.tipo == TipoParametro::EXPRESION) { v.num = evaluar_matematica(a.texto); return; }
+
+    if (a.forma == ArgumentoEnlazado::NOMBRE) {
+        // Un nombre que no es variable se toma al pie de la letra, como siempre
+        // han hecho los módulos: archivos.crear(datos.json) o tiempo.hora(h, HH:MM)
+        const string* t = es_texto_visible(a.texto) ? buscar_vt(a.texto) : nullptr;
+        const double* n = t ? nullptr : buscar_vn(a.texto);
+        if (t) { v.es_texto = true; v.txt = *t; }
+        else if (n) { v.es_texto = false; v.num = *n; v.txt = a_string_universal(*n); }
+        else { v.es_texto = true; v.txt = a.texto; }
+        return;
+    }
+
+    if (a.tipo == TipoParametro::VALOR && !expresion_de_texto(a.texto)) {
+        v.es_texto = false;
+        v.num = evaluar_matematica(a.texto);
+        v.txt = a_string_universal(v.num);
+    }
+    else { v.es_texto = true; v.txt = obtener_texto(a.texto); }
+}
+
+void enlazar_comando(EnlaceModulo& e, const string& cmd, const string& instr) {
+    e = EnlaceModulo();
+    e.generacion = generacion_comandos;
+    auto it = comandos_modulo.find(cmd);
+    if (it == comandos_modulo.end()) return;
+
+    vector<string> crudos;
+    size_t p1 = instr.find('(');
+    size_t p2 = instr.find_last_of(')');
+    if (p1 != string::npos && p2 != string::npos && p2 > p1) crudos = split_smart(instr.substr(p1 + 1, p2 - p1 - 1), ',');
+    if (crudos.size() == 1 && trim(crudos[0]).empty()) crudos.clear();
+
+    size_t n = min(crudos.size(), it->second.tipos.size());
+    e.args.resize(n);
+    e.valores.resize(n);
+    for (size_t i = 0; i < n; i++) precompilar_argumento(crudos[i], it->second.tipos[i], e.args[i], e.valores[i]);
+    e.cmd = &it->second;
+}
+
+// Ejecuta la línea pc si es un comando v2. La primera vez en cada hilo (o si
+// desde entonces se registraron comandos nuevos) la enlaza.
+bool ejecutar_comando_modulo(int pc, const string& cmd, const string& instr) {
+    if (pc < 0 || pc >= (int)enlaces_modulo.size()) return false;
+    bool compartido = pila_padre == nullptr && !en_tarea && !PoolHilos::en_hilo_del_pool();
+    if (!compartido && (enlaces_del_hilo.programa != programa_enlaces || enlaces_del_hilo.enlaces.size() != enlaces_modulo.size())) {
+        enlaces_del_hilo.programa = programa_enlaces;
+        enlaces_del_hilo.enlaces.assign(enlaces_modulo.size(), EnlaceModulo());
+    }
+    EnlaceModulo& e = compartido ? enlaces_modulo[pc] : enlaces_del_hilo.enlaces[pc];
+
+    if (e.generacion != generacion_comandos) enlazar_comando(e, cmd, instr);
+    if (!e.cmd) return false;
+
+    Traza::Tramo tramo(Traza::MODULO, cmd);
+    for (size_t i = 0; i < e.args.size(); i++)
+        if (e.args[i].forma != ArgumentoEnlazado::CONSTANTE) evaluar_argumento(e.args[i], e.valores[i]);
+    if (e.cmd->fn) e.cmd->fn(e.valores);
+    else e.cmd->fn_datos(e.valores, e.cmd->datos);
+    return true;
+}
+
 //MODULOS
 
 void cargar_modulo_externo(string nombre) {
@@ -531,6 +1567,18 @@ void cargar_modulo_externo(string nombre) {
     if (nombre.size() >= 2 && nombre.front() == '"' && nombre.back() == '"') 
         nombre = nombre.substr(1, nombre.size() - 2);
 
+    // Registrar comandos ya registrados no aporta nada cuando el núcleo ejecuta
+    // muchos scripts seguidos (biblioteca o --servidor). 'web' sí se recarga:
+    // cada ejecución trae datos nuevos en el puente.
+    static set<string> modulos_cargados;
+    if (nombre != "web" && modulos_cargados.count(nombre)) return;
+
+    // Las tablas de comandos y funciones nativas se leen sin cerrojo: solo se
+    // modifican cuando no hay otro hilo ejecutando el script
+    if (en_tarea) throw ErrorRedSync("importar no esta permitido dentro de una tarea o un hilo; importa el modulo antes de lanzarlos");
+    if (hay_tareas_pendientes())
+        throw ErrorRedSync("importar: hay tareas o hilos sin esperar; importa el modulo antes de lanzarlos");
+
     if (nombre == "tiempo") {
         ModuloTiempo::cargar();
     }
@@ -547,66 +1595,1245 @@ void cargar_modulo_externo(string nombre) {
         ModuloWeb::cargar();
     }
     else {
-        cout << "[ERROR] Modulo '" << nombre << "' no encontrado." << endl;
+        // Si no es de los incluidos, puede ser una biblioteca libredmod_<nombre>
+        string error;
+        bool encontrado;
+        if (!ModulosNativos::cargar(nombre, error, encontrado)) {
+            if (encontrado) throw ErrorRedSync("modulo '" + nombre + "': " + error);
+            throw ErrorRedSync("modulo '" + nombre + "' no encontrado");
+        }
     }
+    modulos_cargados.insert(nombre);
 }
 
-ValorRetorno ejecutar_bloque(int pc_start, int pc_end) {
-    ValorRetorno retorno;
-    int pc = pc_start;
-    int limit = (pc_end == -1) ? (int)script.size() : pc_end;
+// --- LISTAS RETORNADAS POR FUNCIONES ---
+
+// "f(a, b)" completa como llamada a una función del script
+bool es_llamada_funcion(const string& expr, string& nombre, string& args) {
+    string e = trim(expr);
+    size_t p = e.find('(');
+    if (p == string::npos || e.back() != ')' || cierre_parentesis(e, p) != e.size() - 1) return false;
+    nombre = trim(e.substr(0, p));
+    if (!funciones.count(nombre)) return false;
+    args = e.substr(p + 1, e.size() - p - 2);
+    return true;
+}
 
-    while (pc < limit) {
-        string instr = script[pc];
-        stringstream ss(instr);
-        string cmd; ss >> cmd;
-        string raw_cmd = cmd; 
-        if (cmd.find('(') != string::npos) cmd = cmd.substr(0, cmd.find('('));
+// ln r = f(x) / r = f(x): la lista retornada se mueve al destino sin copiarla.
+// Devuelve false si 'expr' no es una llamada (no se ha ejecutado nada).
+bool asignar_lista_retornada(const string& expr, const string& destino, bool declarar, string& error) {
+    string nombre, args_int;
+    if (!es_llamada_funcion(expr, nombre, args_int)) return false;
+    vector<string> args = split_smart(args_int, ',');
+    if (args.size() == 1 && trim(args[0]).empty()) args.clear();
+    ValorRetorno ret = invocar_funcion_generica(nombre, args);
+
+    if (ret.lista == 'n') {
+        vector<double>* d = declarar ? nullptr : get_ln_ptr(destino);
+        if (!d) d = &pila_memoria.back().ln[destino];
+        *d = move(ret.ln);
+    }
+    else if (ret.lista == 't') {
+        vector<string>* d = declarar ? nullptr : get_lt_ptr(destino);
+        if (!d) d = &pila_memoria.back().lt[destino];
+        *d = move(ret.lt);
+    }
+    else error = "la funcion '" + nombre + "' no retorno una lista";
+    return true;
+}
 
-        if (cmd == "si" || cmd == "mientras") {
-            size_t p1 = instr.find('(');
-            size_t p2 = instr.find_last_of(')');
-            string cond = (p1 != string::npos && p2 != string::npos) ? instr.substr(p1+1, p2-p1-1) : "";
-            if (!evaluar_condicion_maestra(cond)) { pc = saltos[pc]; continue; }
-        }
-        else if (cmd == "sino") { pc = saltos[pc]; continue; }
-        else if (cmd == "si!" || cmd == "funcion!") { /* pass */ }
-        else if (cmd == "mientras!") { pc = saltos[pc] - 1; }
-        
-        else if (cmd == "cada") {
-            size_t p1 = instr.find('(');
-            size_t p2 = instr.find_last_of(')');
-            if (p1 != string::npos && p2 != string::npos) {
-                string contenido = instr.substr(p1+1, p2-p1-1);
-                stringstream ss_c(contenido);
+bool comillas_fuera_de_llamadas(const string& s) {
+    int nivel = 0;
+    for (char c : s) {
+        if (c == '(') nivel++;
+        else if (c == ')') nivel--;
+        else if (c == '"' && nivel == 0) return true;
+    }
+    return false;
+}
+
+// --- ASIGNACIÓN A ELEMENTOS DE LISTA ---
+// lista[i] = expr, y las formas compuestas += -= *= /=.
+// El índice se evalúa una sola vez y el valor se escribe directamente en el
+// vector (sin eliminar/agregar). Un índice fuera de rango es un error.
+
+struct AsignacionElemento {
+    string lista, indice, valor;
+    char op = 0; // 0 = asignación simple
+};
+
+bool parsear_asignacion_elemento(const string& instr, AsignacionElemento& a) {
+    size_t b1 = instr.find('[');
+    if (b1 == string::npos) return false;
+    a.op = 0;
+    a.lista = trim(instr.substr(0, b1));
+    if (a.lista.empty() || a.lista.find_first_of(" (\"=.") != string::npos) return false;
+
+    int bal = 0;
+    size_t b2 = string::npos;
+    for (size_t i = b1; i < instr.size(); i++) {
+        if (instr[i] == '[') bal++;
+        else if (instr[i] == ']' && --bal == 0) { b2 = i; break; }
+    }
+    if (b2 == string::npos) return false;
+
+    size_t k = instr.find_first_not_of(' ', b2 + 1);
+    if (k == string::npos) return false;
+    if (string("+-*/").find(instr[k]) != string::npos && k + 1 < instr.size() && instr[k + 1] == '=') {
+        a.op = instr[k];
+        k += 2;
+    }
+    else if (instr[k] == '=' && (k + 1 >= instr.size() || instr[k + 1] != '=')) k++;
+    else return false;
+
+    a.indice = instr.substr(b1 + 1, b2 - b1 - 1);
+    a.valor = trim(instr.substr(k));
+    return true;
+}
+
+void ejecutar_asignacion_elemento(const AsignacionElemento& a, int pc) {
+    double idx_d = evaluar_matematica(a.indice);
+    auto fuera_de_rango = [&](size_t tam) {
+        emitir_salida("[ERROR] Linea " + to_string(lineas_origen[pc]) + ": indice " + a_string_universal(idx_d) +
+                      " fuera de rango en '" + a.lista + "' (tamano " + to_string(tam) + ")\n");
+    };
+
+    if (get_ln_ptr(a.lista)) {
+        double v = evaluar_matematica(a.valor);
+        // Se vuelve a buscar: evaluar el valor puede haber llamado a una función que cambie la lista
+        vector<double>* ln_ptr = get_ln_ptr(a.lista);
+        if (!ln_ptr || idx_d < 0 || idx_d >= (double)ln_ptr->size()) { fuera_de_rango(ln_ptr ? ln_ptr->size() : 0); return; }
+        double& celda = (*ln_ptr)[(size_t)idx_d];
+        celda = (a.op == 0) ? v : aplicar_mat(celda, v, string(1, a.op));
+    }
+    else if (get_lt_ptr(a.lista)) {
+        if (a.op != 0 && a.op != '+') {
+            emitir_salida("[ERROR] Linea " + to_string(lineas_origen[pc]) + ": '" + string(1, a.op) +
+                          "=' no se puede usar con la lista de texto '" + a.lista + "'\n");
+            return;
+        }
+        string v = obtener_texto(a.valor);
+        vector<string>* lt_ptr = get_lt_ptr(a.lista);
+        if (!lt_ptr || idx_d < 0 || idx_d >= (double)lt_ptr->size()) { fuera_de_rango(lt_ptr ? lt_ptr->size() : 0); return; }
+        string& celda = (*lt_ptr)[(size_t)idx_d];
+        if (a.op == '+') celda += v;
+        else celda = move(v);
+    }
+    else {
+        emitir_salida("[ERROR] Linea " + to_string(lineas_origen[pc]) + ": la lista '" + a.lista + "' no existe\n");
+    }
+}
+
+// --- ORDENAR POR CLAVES ---
+// nombres.ordenar_por(puntos, edades): se calcula una sola vez el orden estable
+// de 'puntos' y esa misma permutación se aplica a nombres, puntos y edades,
+// que deben tener todas el mismo tamaño.
+void ordenar_por(const string& lista, const string& args, int pc) {
+    string prefijo = "[ERROR] Linea " + to_string(lineas_origen[pc]) + ": ordenar_por: ";
+    vector<string> nombres = {lista};
+    for (const string& a : split_smart(args, ',')) if (!trim(a).empty()) nombres.push_back(trim(a));
+    if (nombres.size() < 2) { emitir_salida(prefijo + "falta la lista de claves\n"); return; }
+
+    vector<size_t> perm;
+    if (vector<double>* claves = get_ln_ptr(nombres[1])) perm = Ordenamiento::permutacion(*claves);
+    else if (vector<string>* claves = get_lt_ptr(nombres[1])) perm = Ordenamiento::permutacion(*claves);
+    else { emitir_salida(prefijo + "la lista '" + nombres[1] + "' no existe\n"); return; }
+
+    // Primero se comprueba todo, para no dejar unas listas ordenadas y otras no
+    set<string> distintos;
+    for (const string& n : nombres) {
+        vector<double>* ln_ptr = get_ln_ptr(n);
+        vector<string>* lt_ptr = ln_ptr ? nullptr : get_lt_ptr(n);
+        size_t tam = ln_ptr ? ln_ptr->size() : (lt_ptr ? lt_ptr->size() : 0);
+        if (!ln_ptr && !lt_ptr) { emitir_salida(prefijo + "la lista '" + n + "' no existe\n"); return; }
+        if (tam != perm.size()) {
+            emitir_salida(prefijo + "'" + n + "' tiene " + to_string(tam) + " elementos y '" + nombres[1] +
+                          "' " + to_string(perm.size()) + "\n");
+            return;
+        }
+        distintos.insert(n);
+    }
+    for (const string& n : distintos) {
+        if (vector<double>* ln_ptr = get_ln_ptr(n)) Ordenamiento::aplicar(*ln_ptr, perm);
+        else Ordenamiento::aplicar(*get_lt_ptr(n), perm);
+    }
+}
+
+// --- CADA SOBRE RANGOS Y PORCIONES ---
+// El iterador se guarda en el frame por línea (como contadores_bucle), así que
+// los límites se evalúan al entrar y cada vuelta solo calcula un elemento.
+// Devuelve false cuando se acabaron los elementos (y limpia el estado).
+bool paso_cada_vista(int pc, const string& var_iter, const string& origen) {
+    Contexto& marco = pila_memoria.back();
+    auto it = marco.iteradores_bucle.find(pc);
+    if (it == marco.iteradores_bucle.end()) {
+        IteradorBucle iter;
+        VistaNumerica vn_v;
+        VistaTexto vt_v;
+        string nombre, desde, hasta;
+        if (parsear_rango(origen, iter.inicio, iter.paso, iter.total)) iter.es_rango = true;
+        else if (partes_porcion(origen, nombre, desde, hasta) && (get_ln_ptr(nombre) || get_lt_ptr(nombre))) {
+            vector<double>* ln_ptr = get_ln_ptr(nombre);
+            size_t tam = ln_ptr ? ln_ptr->size() : get_lt_ptr(nombre)->size();
+            size_t fin;
+            limites_porcion(desde, hasta, tam, iter.desde, fin);
+            iter.lista = nombre;
+            iter.total = fin - iter.desde;
+        }
+        it = marco.iteradores_bucle.emplace(pc, iter).first;
+        marco.contadores_bucle[pc] = 0;
+    }
+
+    const IteradorBucle& iter = it->second;
+    size_t idx = (size_t)marco.contadores_bucle[pc];
+    if (idx < iter.total) {
+        if (iter.es_rango) { set_vn(var_iter, iter.inicio + (double)idx * iter.paso, true); return true; }
+        size_t pos = iter.desde + idx;
+        vector<double>* ln_ptr = get_ln_ptr(iter.lista);
+        vector<string>* lt_ptr = ln_ptr ? nullptr : get_lt_ptr(iter.lista);
+        if (ln_ptr && pos < ln_ptr->size()) { set_vn(var_iter, (*ln_ptr)[pos], true); return true; }
+        if (lt_ptr && pos < lt_ptr->size()) { set_vt(var_iter, (*lt_ptr)[pos], true); return true; }
+    }
+    marco.iteradores_bucle.erase(pc);
+    marco.contadores_bucle.erase(pc);
+    return false;
+}
+
+// --- CADA SOBRE LA ENTRADA ---
+// cada (linea en entrada_lineas) da una vuelta por línea de la entrada y
+// cada (fila en entrada_csv(",")) una por fila, con los campos en la lt fila
+// (de texto: numero(fila[1]) los convierte). El registro se escribe
+// directamente en la variable del bucle, que conserva su memoria de una vuelta
+// a otra. El separador se evalúa al entrar y se guarda con el bucle.
+bool paso_cada_entrada(int pc, const string& var_iter, const string& origen) {
+    Contexto& marco = pila_memoria.back();
+    if (origen == "entrada_lineas") {
+        string& linea = marco.vt[var_iter];
+        return origen_entrada ? origen_entrada(linea) : LectorEntrada::linea(linea);
+    }
+
+    auto it = marco.iteradores_bucle.find(pc);
+    if (it == marco.iteradores_bucle.end()) {
+        IteradorBucle iter;
+        size_t p1 = origen.find('('), p2 = origen.find_last_of(')');
+        string arg = (p1 != string::npos && p2 != string::npos && p2 > p1) ? trim(origen.substr(p1 + 1, p2 - p1 - 1)) : "";
+        iter.lista = arg.empty() ? "," : obtener_texto(arg);
+        if (iter.lista.size() != 1) throw ErrorRedSync("entrada_csv: el separador debe ser un solo caracter");
+        it = marco.iteradores_bucle.emplace(pc, iter).first;
+    }
+    char sep = it->second.lista[0];
+    vector<string>& campos = marco.lt[var_iter];
+    bool hay;
+    if (origen_entrada) {
+        string linea;
+        hay = origen_entrada(linea);
+        if (hay) LectorEntrada::partir(linea.data(), linea.size(), sep, campos);
+    }
+    else hay = LectorEntrada::fila(sep, campos);
+    if (!hay) marco.iteradores_bucle.erase(pc);
+    return hay;
+}
+
+// --- CADA PARALELO ---
+// cada_paralelo (x en lista) reducir(suma total, maximo mayor) recoger(y en salida)
+// Reparte los elementos entre los hilos del pool. Cada trabajador escribe en su
+// propio frame; lo único que vuelve al programa son las reducciones declaradas
+// y las listas de recogida (un valor por índice, en el mismo orden de la lista).
+
+struct CadaParalelo {
+    string var_iter;
+    string nombre_lista;
+    vector<pair<string, string>> reducciones;   // {operacion, variable}
+    vector<pair<string, string>> recolecciones; // {variable del cuerpo, lista destino}
+};
+
+// Extrae el contenido del primer "palabra(...)" que aparezca después de 'desde'
+string extraer_clausula(const string& instr, const string& palabra, size_t desde) {
+    size_t p = instr.find(palabra + "(", desde);
+    if (p == string::npos) return "";
+    size_t ini = p + palabra.size() + 1;
+    size_t fin = instr.find(')', ini);
+    if (fin == string::npos) return "";
+    return instr.substr(ini, fin - ini);
+}
+
+bool parsear_cada_paralelo(const string& instr, CadaParalelo& cp) {
+    size_t p1 = instr.find('(');
+    size_t p2 = (p1 == string::npos) ? string::npos : instr.find(')', p1);
+    if (p1 == string::npos || p2 == string::npos) return false;
+
+    stringstream ss_c(instr.substr(p1 + 1, p2 - p1 - 1));
+    string en_kw;
+    ss_c >> cp.var_iter >> en_kw >> cp.nombre_lista;
+    if (cp.var_iter.empty() || en_kw != "en" || cp.nombre_lista.empty()) return false;
+
+    for (const string& parte : split_smart(extraer_clausula(instr, "reducir", p2), ',')) {
+        stringstream ss_r(parte);
+        string op, var;
+        if (!(ss_r >> op >> var)) continue;
+        if (op != "suma" && op != "producto" && op != "maximo" && op != "minimo") return false;
+        cp.reducciones.push_back({op, var});
+    }
+    for (const string& parte : split_smart(extraer_clausula(instr, "recoger", p2), ',')) {
+        stringstream ss_r(parte);
+        string var, en, destino;
+        if (!(ss_r >> var)) continue;
+        if (!(ss_r >> en >> destino) || en != "en") return false;
+        cp.recolecciones.push_back({var, destino});
+    }
+    return true;
+}
+
+double identidad_reduccion(const string& op) {
+    if (op == "producto") return 1.0;
+    if (op == "maximo") return -numeric_limits<double>::infinity();
+    if (op == "minimo") return numeric_limits<double>::infinity();
+    return 0.0;
+}
+
+double combinar_reduccion(const string& op, double a, double b) {
+    if (op == "producto") return a * b;
+    if (op == "maximo") return max(a, b);
+    if (op == "minimo") return min(a, b);
+    return a + b;
+}
+
+// Revisión en carga: el cuerpo solo puede escribir en variables propias del
+// cuerpo, en la variable de iteración o en los destinos de reducción. Las
+// funciones a las que llama (directa o indirectamente) corren en el trabajador
+// y se revisan con las mismas reglas; como sus parámetros de lista pueden ser
+// listas del padre pasadas por referencia, solo pueden modificar las listas
+// que declaran ellas mismas.
+string revisar_cuerpo_paralelo(int ini, int fin, set<string> escalares, set<string> listas,
+                               const string& funcion, set<string>& revisadas);
+
+string revisar_llamada_paralela(const string& nombre, set<string>& revisadas) {
+    if (!revisadas.insert(nombre).second) return ""; // ya revisada (o en curso, si es recursiva)
+    const InfoFuncion& info = funciones[nombre];
+    int ini = info.linea_inicio;
+    int fin = saltos.count(ini - 1) ? saltos[ini - 1] : (int)script.size();
+    set<string> escalares(info.parametros.begin(), info.parametros.end());
+    return revisar_cuerpo_paralelo(ini, fin, escalares, set<string>(), nombre, revisadas);
+}
+
+string revisar_cuerpo_paralelo(int ini, int fin, set<string> escalares, set<string> listas,
+                               const string& funcion, set<string>& revisadas) {
+    auto donde = [&](int i) {
+        return " (linea " + to_string(lineas_origen[i]) + (funcion.empty() ? "" : ", en la funcion '" + funcion + "'") + ")";
+    };
+
+    for (int i = ini; i < fin; i++) {
+        stringstream ss(script[i]);
+        string cmd, nombre;
+        ss >> cmd >> nombre;
+        string propio;
+        if (cmd == "vn" || cmd == "vt" || cmd == "ln" || cmd == "lt" || cmd == "mapa") {
+            propio = nombre.substr(0, nombre.find('='));
+        }
+        else if (cmd.rfind("contar", 0) == 0 || cmd.rfind("cada", 0) == 0) {
+            size_t p1 = script[i].find('(');
+            if (p1 != string::npos) {
+                stringstream ss_v(script[i].substr(p1 + 1));
+                ss_v >> propio;
+            }
+        }
+        if (!propio.empty()) { escalares.insert(propio); listas.insert(propio); }
+        // Un cada_paralelo dentro de una función llamada corre en secuencia en el
+        // trabajador: sus reducciones quedan en el frame de la función
+        CadaParalelo anidado;
+        if (cmd.rfind("cada_paralelo", 0) == 0 && parsear_cada_paralelo(script[i], anidado))
+            for (const auto& r : anidado.reducciones) escalares.insert(r.second);
+    }
+
+    for (int i = ini; i < fin; i++) {
+        const string& instr = script[i];
+        stringstream ss(instr);
+        string cmd; ss >> cmd;
+        string raw_cmd = cmd;
+        if (cmd.find('(') != string::npos) cmd = cmd.substr(0, cmd.find('('));
+
+        if (cmd == "importar" || ((cmd == "retornar" || cmd == "cada_paralelo") && funcion.empty()) || cmd == "tarea" ||
+            cmd == "hilo" || cmd == "canal" || cmd == "esperar" || cmd == "esperar_todas" || cmd == "recibir")
+            return "'" + cmd + "' no esta permitido dentro de cada_paralelo" + donde(i);
+        if (cmd == "cada" && instr.find("entrada_") != string::npos)
+            return "leer la entrada no esta permitido dentro de cada_paralelo" + donde(i);
+
+        // Llamadas dentro de la línea (también en expresiones)
+        bool comillas = false;
+        for (size_t k = 0; k < instr.size(); k++) {
+            if (instr[k] == '"') { comillas = !comillas; continue; }
+            if (comillas || !(isalpha((unsigned char)instr[k]) || instr[k] == '_')) continue;
+            if (k > 0 && (isalnum((unsigned char)instr[k - 1]) || instr[k - 1] == '_' || instr[k - 1] == '.')) continue;
+            size_t f = k;
+            while (f < instr.size() && (isalnum((unsigned char)instr[f]) || instr[f] == '_')) f++;
+            string llamado = instr.substr(k, f - k);
+            size_t sig = instr.find_first_not_of(' ', f);
+            k = f - 1;
+            if (sig == string::npos || instr[sig] != '(') continue;
+            if (llamado == "entrada" || llamado == "esperar" || llamado == "esperar_todas" || llamado == "recibir")
+                return "'" + llamado + "' no esta permitido dentro de cada_paralelo" + donde(i);
+            if (funciones.count(llamado)) {
+                string error = revisar_llamada_paralela(llamado, revisadas);
+                if (!error.empty()) return error;
+            }
+        }
+
+        if (cmd == "si" || cmd == "sino" || cmd == "si!" || cmd == "mientras" || cmd == "mientras!" ||
+            cmd == "contar" || cmd == "contar!" || cmd == "cada" || cmd == "cada!" || cmd == "mostrar" ||
+            cmd == "retornar" || cmd == "cada_paralelo" || cmd == "cada_paralelo!" || cmd == "ln" || cmd == "lt" ||
+            cmd == "mapa") continue;
+
+        if (raw_cmd.find('.') != string::npos) {
+            string var = raw_cmd.substr(0, raw_cmd.find('.'));
+            if (!listas.count(var))
+                return "'" + raw_cmd.substr(0, raw_cmd.find('(')) + "' modifica una lista compartida o llama a un modulo" + donde(i);
+            continue;
+        }
+
+        size_t eq = instr.find('=');
+        if (eq != string::npos && instr.find("==") == string::npos) {
+            stringstream ss_l(instr.substr(0, eq));
+            string primero;
+            ss_l >> primero;
+            if (primero == "vn" || primero == "vt") continue;
+            bool elemento = primero.find('[') != string::npos; // lista[i] = ...
+            string destino = primero.substr(0, primero.find('['));
+            while (!destino.empty() && strchr("+-*/", destino.back())) destino.pop_back(); // x+= 1
+            if (!destino.empty() && !(elemento ? listas : escalares).count(destino))
+                return "escritura en la variable compartida '" + destino + "'" + donde(i) +
+                       (funcion.empty() ? ". Declarala dentro del cuerpo o usa reducir(...)" : ". Declarala dentro de la funcion");
+        }
+    }
+    return "";
+}
+
+// Devuelve "" si el cuerpo (ini, fin) es correcto, o el mensaje de error
+string validar_cada_paralelo(int ini, int fin) {
+    CadaParalelo cp;
+    if (!parsear_cada_paralelo(script[ini], cp)) 
+        return "Cabecera invalida. Uso: cada_paralelo (x en lista) reducir(suma total) recoger(y en salida)";
+
+    set<string> locales = {cp.var_iter};
+    for (const auto& r : cp.reducciones) locales.insert(r.second);
+    set<string> revisadas;
+    return revisar_cuerpo_paralelo(ini + 1, fin, locales, locales, "", revisadas);
+}
+
+// --- FUNCIONES PURAS ---
+// Reutilizar un resultado guardado salta el cuerpo entero, así que el cuerpo no
+// puede tener efectos: ni mostrar, entrada o importar, ni comandos de módulos,
+// ni escrituras en variables que no sean suyas, ni llamadas a funciones que no
+// sean puras. Tampoco puede leer variables que no sean suyas (globales o de
+// quien la llama): el resultado guardado no cambiaría al cambiar ellas.
+
+// Palabras de las líneas de una función que no son variables
+bool es_palabra_reservada(const string& palabra, const string& cmd) {
+    static const set<string> generales = {"vn", "vt", "ln", "lt", "mapa", "si", "sino", "mientras", "contar",
+                                          "cada", "cada_paralelo", "retornar"};
+    if (generales.count(palabra)) return true;
+    string up = palabra;
+    for (char& c : up) c = (char)toupper((unsigned char)c);
+    if (up == "Y" || up == "O" || up == "NO") return true;
+    if (cmd == "contar") return palabra == "de" || palabra == "a";
+    if (cmd == "cada") return palabra == "en";
+    if (cmd == "cada_paralelo")
+        return palabra == "en" || palabra == "suma" || palabra == "producto" || palabra == "maximo" || palabra == "minimo";
+    return false;
+}
+
+string validar_funcion_pura(const string& nombre, const InfoFuncion& info) {
+    int ini = info.linea_inicio;
+    int fin = saltos.count(ini - 1) ? saltos[ini - 1] : (int)script.size();
+    auto donde = [&](int i) { return " (linea " + to_string(lineas_origen[i]) + ")"; };
+
+    set<string> locales(info.parametros.begin(), info.parametros.end());
+    for (int i = ini; i < fin; i++) {
+        stringstream ss(script[i]);
+        string cmd, nombre_var;
+        ss >> cmd >> nombre_var;
+        if (cmd == "vn" || cmd == "vt" || cmd == "ln" || cmd == "lt" || cmd == "mapa") {
+            locales.insert(nombre_var.substr(0, nombre_var.find('=')));
+        }
+        else if (cmd.rfind("contar", 0) == 0 || cmd.rfind("cada", 0) == 0) {
+            size_t p1 = script[i].find('(');
+            if (p1 != string::npos) {
+                stringstream ss_v(script[i].substr(p1 + 1));
+                string v; ss_v >> v;
+                locales.insert(v);
+            }
+        }
+    }
+
+    for (int i = ini; i < fin; i++) {
+        const string& instr = script[i];
+        stringstream ss(instr);
+        string cmd; ss >> cmd;
+        string raw_cmd = cmd;
+        if (cmd.find('(') != string::npos) cmd = cmd.substr(0, cmd.find('('));
+
+        if (cmd == "mostrar" || cmd == "importar" || cmd == "tarea" || cmd == "hilo" || cmd == "canal")
+            return "'" + cmd + "' no esta permitido en la funcion pura '" + nombre + "'" + donde(i);
+        if (cmd == "cada" && instr.find("entrada_") != string::npos)
+            return "leer la entrada no esta permitido en la funcion pura '" + nombre + "'" + donde(i);
+
+        // Llamadas dentro de la línea (también en expresiones)
+        bool comillas = false;
+        for (size_t k = 0; k < instr.size(); k++) {
+            if (instr[k] == '"') { comillas = !comillas; continue; }
+            if (comillas || !(isalpha((unsigned char)instr[k]) || instr[k] == '_')) continue;
+            if (k > 0 && (isalnum((unsigned char)instr[k - 1]) || instr[k - 1] == '_' || instr[k - 1] == '.')) continue;
+            size_t f = k;
+            while (f < instr.size() && (isalnum((unsigned char)instr[f]) || instr[f] == '_')) f++;
+            string llamado = instr.substr(k, f - k);
+            size_t sig = instr.find_first_not_of(' ', f);
+            k = f - 1;
+            if (sig == string::npos || instr[sig] != '(') {
+                if (locales.count(llamado) || es_palabra_reservada(llamado, cmd)) continue;
+                if (sig != string::npos && instr[sig] == '.')
+                    return "'" + llamado + "' es un modulo o una lista ajena a la funcion pura '" + nombre + "'" + donde(i);
+                return "la funcion pura '" + nombre + "' lee la variable '" + llamado + "', que no es suya" + donde(i) +
+                       ". Pasala como argumento";
+            }
+            if (llamado == "entrada" || llamado == "esperar" || llamado == "esperar_todas" || llamado == "enviar" ||
+                llamado == "recibir" || llamado == "cerrar")
+                return "'" + llamado + "' no esta permitido en la funcion pura '" + nombre + "'" + donde(i);
+            auto llamada = funciones.find(llamado);
+            if (llamada != funciones.end() && !llamada->second.pura)
+                return "la funcion pura '" + nombre + "' llama a '" + llamado + "', que no es pura" + donde(i);
+        }
+
+        if (cmd == "si" || cmd == "sino" || cmd == "si!" || cmd == "mientras" || cmd == "mientras!" ||
+            cmd == "contar" || cmd == "contar!" || cmd == "cada" || cmd == "cada!" || cmd == "retornar" ||
+            cmd == "cada_paralelo" || cmd == "cada_paralelo!" || cmd == "ln" || cmd == "lt" || cmd == "mapa") continue;
+
+        if (raw_cmd.find('.') != string::npos) {
+            string var = raw_cmd.substr(0, raw_cmd.find('.'));
+            if (!locales.count(var))
+                return "'" + raw_cmd.substr(0, raw_cmd.find('(')) + "' llama a un modulo o modifica una lista ajena en la funcion pura '" +
+                       nombre + "'" + donde(i);
+            continue;
+        }
+
+        size_t eq = instr.find('=');
+        if (eq != string::npos && instr.find("==") == string::npos) {
+            stringstream ss_l(instr.substr(0, eq));
+            string primero;
+            ss_l >> primero;
+            string destino = (primero == "vn" || primero == "vt") ? "" : primero.substr(0, primero.find('['));
+            while (!destino.empty() && strchr("+-*/", destino.back())) destino.pop_back(); // x+= 1
+            if (!destino.empty() && !locales.count(destino))
+                return "la funcion pura '" + nombre + "' escribe en la variable '" + destino + "', que no es suya" + donde(i);
+        }
+    }
+    return "";
+}
+
+// Ejecuta el bloque completo; al volver, pc debe saltar a saltos[pc].
+void ejecutar_cada_paralelo(int pc) {
+    CadaParalelo cp;
+    if (!parsear_cada_paralelo(script[pc], cp)) return;
+    int cuerpo_ini = pc + 1;
+    int cuerpo_fin = saltos[pc] - 1; // línea del cada_paralelo!
+
+    vector<double>* ln_ptr = get_ln_ptr(cp.nombre_lista);
+    vector<string>* lt_ptr = ln_ptr ? nullptr : get_lt_ptr(cp.nombre_lista);
+    size_t n = ln_ptr ? ln_ptr->size() : (lt_ptr ? lt_ptr->size() : 0);
+
+    // Un cada_paralelo alcanzado desde dentro de otro (por ejemplo en una función
+    // llamada por el cuerpo) se ejecuta en secuencia sobre el frame del trabajador;
+    // dentro de una tarea, también (el pool es del hilo del programa), y si el
+    // sistema no pudo crear ningún trabajador.
+    if (pila_padre != nullptr || en_tarea || PoolHilos::en_hilo_del_pool() || PoolHilos::instancia().tamano() == 0) {
+        for (size_t i = 0; i < n; i++) {
+            if (ln_ptr) set_vn(cp.var_iter, (*ln_ptr)[i], true);
+            else set_vt(cp.var_iter, (*lt_ptr)[i], true);
+            ejecutar_bloque(cuerpo_ini, cuerpo_fin);
+        }
+        return;
+    }
+
+    PoolHilos& pool = PoolHilos::instancia();
+    size_t nr = cp.reducciones.size();
+    vector<vector<double>> parciales(pool.tamano(), vector<double>(nr));
+    for (auto& p : parciales)
+        for (size_t r = 0; r < nr; r++) p[r] = identidad_reduccion(cp.reducciones[r].first);
+
+    // La línea "vt y = ..." dentro del cuerpo decide si la recogida es de texto
+    vector<bool> recoge_texto;
+    for (const auto& rc : cp.recolecciones) {
+        bool texto = false;
+        for (int i = cuerpo_ini; i < cuerpo_fin; i++) {
+            stringstream ss(script[i]);
+            string tipo, nombre; ss >> tipo >> nombre;
+            if (tipo == "vt" && nombre.substr(0, nombre.find('=')) == rc.first) texto = true;
+        }
+        recoge_texto.push_back(texto);
+    }
+    vector<vector<double>> salidas_n(cp.recolecciones.size());
+    vector<vector<string>> salidas_t(cp.recolecciones.size());
+    for (size_t r = 0; r < cp.recolecciones.size(); r++) {
+        if (recoge_texto[r]) salidas_t[r].resize(n);
+        else salidas_n[r].resize(n);
+    }
+
+    const vector<Contexto>* pila_principal = &pila_memoria;
+    size_t bloque = max<size_t>(1, n / (pool.tamano() * 8));
+
+    pool.para_cada_bloque(n, bloque, [&](size_t ini, size_t fin, int hilo) {
+        Limites::AporteMemoria aporte;
+        pila_padre = pila_principal;
+        pila_memoria.assign(1, Contexto());
+        for (size_t r = 0; r < nr; r++) set_vn(cp.reducciones[r].second, parciales[hilo][r], true);
+
+        for (size_t i = ini; i < fin; i++) {
+            if (ln_ptr) set_vn(cp.var_iter, (*ln_ptr)[i], true);
+            else set_vt(cp.var_iter, (*lt_ptr)[i], true);
+            ejecutar_bloque(cuerpo_ini, cuerpo_fin);
+            for (size_t r = 0; r < cp.recolecciones.size(); r++) {
+                if (recoge_texto[r]) salidas_t[r][i] = get_vt(cp.recolecciones[r].first);
+                else salidas_n[r][i] = get_vn(cp.recolecciones[r].first);
+            }
+        }
+
+        for (size_t r = 0; r < nr; r++) parciales[hilo][r] = get_vn(cp.reducciones[r].second);
+        pila_memoria.clear();
+        pila_padre = nullptr;
+    });
+
+    for (size_t r = 0; r < nr; r++) {
+        const string& op = cp.reducciones[r].first;
+        double acumulado = get_vn(cp.reducciones[r].second);
+        for (const auto& p : parciales) acumulado = combinar_reduccion(op, acumulado, p[r]);
+        set_vn(cp.reducciones[r].second, acumulado);
+    }
+    for (size_t r = 0; r < cp.recolecciones.size(); r++) {
+        const string& destino = cp.recolecciones[r].second;
+        if (recoge_texto[r]) pila_memoria.back().lt[destino] = move(salidas_t[r]);
+        else pila_memoria.back().ln[destino] = move(salidas_n[r]);
+    }
+}
+
+// --- TAREAS ---
+// "tarea t = f(a, b)" ejecuta f en un hilo propio y sigue con la línea
+// siguiente; en la vn t queda el número de la tarea. La tarea trabaja sobre una
+// copia de la pila tal como estaba al lanzarla (solo de las variables que puede
+// nombrar): ve lo mismo que vería la llamada normal, pero lo que escribe se
+// queda en ella. Lo que retorna se
+// recoge con esperar(t), esperar(t, destino) o esperar_todas(...). Un comando
+// que bloquea (sistema.esperar, web, archivos, entrada) solo para el hilo de su
+// tarea, así que las esperas de varias tareas se solapan.
+
+struct Tarea {
+    string funcion;
+    const void* duenio = nullptr; // hilo que la lanzó (ver esperar_pendientes)
+    ValorRetorno resultado;
+    unique_ptr<HiloEjecucion::Lanzado> hilo; // al destruirse espera al hilo
+};
+
+mutex mutex_tareas;
+map<int, shared_ptr<Tarea>> tareas; // lanzadas y todavía sin esperar
+int siguiente_tarea = 1;
+
+void esperar_pendientes(const void* duenio);
+
+bool hay_tareas_pendientes() {
+    lock_guard<mutex> lk(mutex_tareas);
+    return !tareas.empty();
+}
+
+// Pila nativa de un hilo que ejecuta el script (ver HiloEjecucion.hpp)
+size_t bytes_pila_script() {
+    return HiloEjecucion::bytes_para(profundidad_maxima);
+}
+
+// La llamada "f(args)" de una línea 'tarea' o 'hilo'. 'palabra' es la que
+// abre la línea, para los mensajes de error.
+void parsear_llamada_tarea(const string& palabra, const string& llamada, const string& uso,
+                           string& nombre, string& args_int) {
+    if (es_llamada_funcion(llamada, nombre, args_int)) return;
+    string l = trim(llamada);
+    string f = trim(l.substr(0, l.find('(')));
+    if (l.find('(') != string::npos && !f.empty() && !funciones.count(f))
+        throw ErrorRedSync(palabra + ": la funcion '" + f + "' no existe");
+    throw ErrorRedSync(uso);
+}
+
+// Identificadores de un texto, también dentro de comillas: los módulos
+// reciben nombres de variables como texto ("dados") y sobra no estorba
+void anotar_identificadores(const string& texto, set<string>& destino) {
+    for (size_t k = 0; k < texto.size();) {
+        if (!(isalpha((unsigned char)texto[k]) || texto[k] == '_')) { k++; continue; }
+        size_t f = k;
+        while (f < texto.size() && (isalnum((unsigned char)texto[f]) || texto[f] == '_')) f++;
+        destino.insert(texto.substr(k, f - k));
+        k = f;
+    }
+}
+
+// Lo que puede leer una tarea de la función 'nombre': los identificadores de su
+// cuerpo y de los de las funciones a las que llama. Se calcula una vez por
+// función y programa.
+shared_ptr<const set<string>> nombres_de_tarea(const string& nombre) {
+    static mutex m;
+    static unsigned programa = 0;
+    static map<string, shared_ptr<const set<string>>> calculados;
+    lock_guard<mutex> lk(m);
+    if (programa != programa_enlaces) { calculados.clear(); programa = programa_enlaces; }
+    auto it = calculados.find(nombre);
+    if (it != calculados.end()) return it->second;
+
+    auto nombres = make_shared<set<string>>();
+    set<string> recorridas;
+    vector<string> pendientes = {nombre};
+    while (!pendientes.empty()) {
+        string f = pendientes.back();
+        pendientes.pop_back();
+        auto fi = funciones.find(f);
+        if (fi == funciones.end() || !recorridas.insert(f).second) continue;
+        int ini = fi->second.linea_inicio;
+        auto fin_it = saltos.find(ini - 1);
+        int fin = fin_it != saltos.end() ? fin_it->second : (int)script.size();
+        for (int i = ini; i < fin; i++) anotar_identificadores(script[i], *nombres);
+        for (const string& n : *nombres)
+            if (funciones.count(n) && !recorridas.count(n)) pendientes.push_back(n);
+    }
+    calculados[nombre] = nombres;
+    return nombres;
+}
+
+// La pila que recibe la tarea: los mismos frames, pero en cada uno solo las
+// variables que la función o sus argumentos pueden nombrar (y las listas a las
+// que apuntan sus referencias). Lanzar una tarea cuesta lo que ella usa, no lo
+// que ocupan todas las listas globales.
+vector<Contexto> copia_para_tarea(const set<string>& de_funcion, const set<string>& de_argumentos) {
+    auto usado = [&](const string& n) { return de_funcion.count(n) || de_argumentos.count(n); };
+    set<pair<size_t, string>> apuntadas;
+    for (const Contexto& c : pila_memoria)
+        for (const auto& r : c.refs)
+            if (usado(r.first) && r.second.pila == &pila_memoria) apuntadas.insert({r.second.marco, r.second.nombre});
+
+    vector<Contexto> copia(pila_memoria.size());
+    for (size_t i = 0; i < pila_memoria.size(); i++) {
+        const Contexto& o = pila_memoria[i];
+        Contexto& d = copia[i];
+        auto copiar = [&](const auto& origen, auto& destino) {
+            for (const auto& v : origen)
+                if (usado(v.first) || (!apuntadas.empty() && apuntadas.count({i, v.first}))) destino.insert(destino.end(), v);
+        };
+        copiar(o.vn, d.vn);
+        copiar(o.vt, d.vt);
+        copiar(o.ln, d.ln);
+        copiar(o.lt, d.lt);
+        copiar(o.mp, d.mp);
+        for (const auto& r : o.refs)
+            if (usado(r.first) && r.second.pila == &pila_memoria) d.refs.insert(d.refs.end(), r);
+        d.contadores_bucle = o.contadores_bucle;
+        d.iteradores_bucle = o.iteradores_bucle;
+        d.funcion = o.funcion;
+    }
+    return copia;
+}
+
+// Lanza f(args) en su propio hilo y devuelve el número de la tarea
+int lanzar_tarea(const string& nombre, const string& args_int) {
+    if (pila_padre != nullptr || PoolHilos::en_hilo_del_pool())
+        throw ErrorRedSync("no se puede lanzar una tarea ni un hilo dentro de cada_paralelo");
+    vector<string> args = split_smart(args_int, ',');
+    if (args.size() == 1 && trim(args[0]).empty()) args.clear();
+
+    auto t = make_shared<Tarea>();
+    t->funcion = nombre;
+    t->duenio = &en_tarea;
+    Tarea* destino = t.get();
+    vector<Contexto>* origen = &pila_memoria;
+    ModuloRandom::Herencia aleatorio = ModuloRandom::herencia_para_tarea();
+    // La copia se hace aquí, en el hilo dueño de la pila
+    set<string> de_argumentos;
+    anotar_identificadores(args_int, de_argumentos);
+    vector<Contexto> copia = copia_para_tarea(*nombres_de_tarea(nombre), de_argumentos);
+    // Pila de hilo auxiliar: la profundidad de la tarea se limita a PROFUNDIDAD_AUXILIAR
+    size_t bytes = HiloEjecucion::bytes_para(min(profundidad_maxima, HiloEjecucion::PROFUNDIDAD_AUXILIAR));
+    t->hilo.reset(new HiloEjecucion::Lanzado(bytes, [destino, origen, nombre, args, aleatorio, copia = move(copia)]() mutable {
+        en_tarea = true;
+        ModuloRandom::heredar(aleatorio);
+        Limites::AporteMemoria aporte;
+        pila_memoria = move(copia);
+        // Las listas pasadas por referencia apuntan ahora a los frames de la copia
+        for (Contexto& c : pila_memoria)
+            for (auto& r : c.refs)
+                if (r.second.pila == origen) r.second.pila = &pila_memoria;
+        try {
+            destino->resultado = invocar_funcion_generica(nombre, args);
+        } catch (...) {
+            cerrar_todos_los_canales();
+            try { esperar_pendientes(&en_tarea); } catch (...) {}
+            throw;
+        }
+        esperar_pendientes(&en_tarea); // una tarea acaba cuando acaban las que lanzó
+        pila_memoria.clear();
+    }));
+    if (!t->hilo->iniciado())
+        throw ErrorRedSync("no se pudo crear el hilo de '" + nombre + "' (el sistema no tiene memoria para su pila)");
+
+    int id;
+    {
+        lock_guard<mutex> lk(mutex_tareas);
+        id = siguiente_tarea++;
+        tareas[id] = t;
+    }
+    return id;
+}
+
+// tarea t = f(args)
+void sentencia_tarea(const string& instr) {
+    const string uso = "tarea: se esperaba 'tarea nombre = funcion(argumentos)'";
+    size_t eq = instr.find('=');
+    if (eq == string::npos) throw ErrorRedSync(uso);
+    stringstream ss(instr.substr(0, eq));
+    string palabra, var, sobra;
+    ss >> palabra >> var >> sobra;
+    if (var.empty() || !sobra.empty()) throw ErrorRedSync(uso);
+    string nombre, args_int;
+    parsear_llamada_tarea("tarea", instr.substr(eq + 1), uso, nombre, args_int);
+    set_vn(var, lanzar_tarea(nombre, args_int), true);
+}
+
+// hilo f(args): una tarea sin número. Se espera con esperar_todas() o al
+// terminar quien la lanzó.
+void sentencia_hilo(const string& instr) {
+    string nombre, args_int;
+    parsear_llamada_tarea("hilo", trim(instr).substr(4), "hilo: se esperaba 'hilo funcion(argumentos)'", nombre, args_int);
+    lanzar_tarea(nombre, args_int);
+}
+
+
+// Espera a la tarea 'id' y la da por recogida. Un error que abortó la tarea
+// se relanza aquí con la línea (de la función) donde se produjo.
+ValorRetorno esperar_tarea(int id) {
+    shared_ptr<Tarea> t;
+    {
+        lock_guard<mutex> lk(mutex_tareas);
+        auto it = tareas.find(id);
+        if (it == tareas.end()) throw ErrorRedSync("esperar: no hay ninguna tarea " + to_string(id) + " pendiente");
+        t = it->second;
+        tareas.erase(it);
+    }
+    try {
+        t->hilo->unir();
+    } catch (const ErrorRedSync& e) {
+        ErrorRedSync error("en la tarea '" + t->funcion + "': " + e.what());
+        error.linea = e.linea;
+        throw error;
+    }
+    return move(t->resultado);
+}
+
+// Espera a todas las tareas lanzadas desde el hilo 'duenio' (nullptr: todas).
+// Si alguna falló, el primer error se relanza después de esperar al resto.
+void esperar_pendientes(const void* duenio) {
+    exception_ptr primero;
+    for (;;) {
+        vector<int> ids;
+        {
+            lock_guard<mutex> lk(mutex_tareas);
+            for (auto& t : tareas)
+                if (!duenio || t.second->duenio == duenio) ids.push_back(t.first);
+        }
+        if (ids.empty()) break;
+        for (int id : ids) {
+            try { esperar_tarea(id); }
+            catch (...) { if (!primero) primero = current_exception(); }
+        }
+    }
+    if (primero) rethrow_exception(primero);
+}
+
+// esperar_todas() espera a las que lanzó este hilo; esperar_todas(t1, ids)
+// a las indicadas, por número o en una ln de números.
+void esperar_todas(const vector<string>& args) {
+    if (args.empty()) { esperar_pendientes(&en_tarea); return; }
+    vector<int> ids;
+    for (const string& a : args) {
+        vector<double>* l = get_ln_ptr(trim(a));
+        if (l) for (double v : *l) ids.push_back((int)v);
+        else ids.push_back((int)evaluar_matematica(a));
+    }
+    exception_ptr primero;
+    for (int id : ids) {
+        try { esperar_tarea(id); }
+        catch (...) { if (!primero) primero = current_exception(); }
+    }
+    if (primero) rethrow_exception(primero);
+}
+
+// esperar(t) descarta el resultado; esperar(t, destino) lo guarda según su
+// tipo (vn, vt, ln o lt).
+void esperar_sentencia(const vector<string>& args) {
+    if (args.empty() || args.size() > 2) throw ErrorRedSync("esperar: se esperaba esperar(tarea) o esperar(tarea, destino)");
+    ValorRetorno r = esperar_tarea((int)evaluar_matematica(args[0]));
+    if (args.size() < 2) return;
+    string destino = trim(args[1]);
+    if (r.lista == 'n') {
+        vector<double>* d = get_ln_ptr(destino);
+        if (!d) d = &pila_memoria.back().ln[destino];
+        *d = move(r.ln);
+    }
+    else if (r.lista == 't') {
+        vector<string>* d = get_lt_ptr(destino);
+        if (!d) d = &pila_memoria.back().lt[destino];
+        *d = move(r.lt);
+    }
+    else if (r.es_texto) set_vt(destino, r.t);
+    else set_vn(destino, r.n);
+}
+
+// --- CANALES ---
+// "canal c = 64" crea una cola acotada entre hilos (Canal.hpp) y deja su número
+// en la vn c; como es un número, viaja en la copia de la pila de cada tarea o
+// hilo. enviar(c, valor) espera si el canal está lleno, recibir(c, x) si está
+// vacío: la capacidad frena a la etapa más rápida de un pipeline. recibir
+// vale 1 si dejó un valor en x y 0 cuando el canal está cerrado y vacío, así
+// que una etapa se escribe como mientras (recibir(c, x) == 1) ... mientras!.
+
+mutex mutex_canales;
+map<int, shared_ptr<Canal>> canales; // viven hasta la siguiente ejecución
+int siguiente_canal = 1;
+
+shared_ptr<Canal> canal_de(const string& orden, const string& arg) {
+    int id = (int)evaluar_matematica(arg);
+    lock_guard<mutex> lk(mutex_canales);
+    auto it = canales.find(id);
+    if (it == canales.end()) throw ErrorRedSync(orden + ": no existe el canal " + to_string(id));
+    return it->second;
+}
+
+// canal c = capacidad (64 si no se indica)
+void sentencia_canal(const string& instr) {
+    size_t eq = instr.find('=');
+    stringstream ss(instr.substr(0, eq));
+    string palabra, var, sobra;
+    ss >> palabra >> var >> sobra;
+    if (var.empty() || !sobra.empty()) throw ErrorRedSync("canal: se esperaba 'canal nombre = capacidad'");
+    double capacidad = eq == string::npos ? 64 : evaluar_matematica(instr.substr(eq + 1));
+    if (capacidad < 1 || capacidad > (1 << 24)) throw ErrorRedSync("canal: la capacidad debe estar entre 1 y 16777216");
+    int id;
+    {
+        lock_guard<mutex> lk(mutex_canales);
+        id = siguiente_canal++;
+        canales[id] = make_shared<Canal>((size_t)capacidad, &Limites::revisar_espera);
+    }
+    set_vn(var, id, true);
+}
+
+// enviar(c, valor): texto o número con la misma regla que retornar
+void enviar_a_canal(const vector<string>& args) {
+    if (args.size() != 2) throw ErrorRedSync("enviar: se esperaba enviar(canal, valor)");
+    shared_ptr<Canal> c = canal_de("enviar", args[0]);
+    string expr = trim(args[1]);
+    Mensaje m;
+    m.es_texto = !expr.empty() && (expr.front() == '"' || es_texto_visible(expr) ||
+                                   (expr.find('"') != string::npos && expr.find('+') != string::npos));
+    if (m.es_texto) m.t = obtener_texto(expr);
+    else m.n = evaluar_matematica(expr);
+    if (!c->enviar(move(m))) throw ErrorRedSync("enviar: el canal " + to_string((int)evaluar_matematica(args[0])) + " esta cerrado");
+}
+
+// recibir(c, x): 1 y el valor en x (vn o vt), o 0 si el canal se cerró y está vacío
+double recibir_de_canal(const vector<string>& args) {
+    if (args.size() != 2) throw ErrorRedSync("recibir: se esperaba recibir(canal, destino)");
+    shared_ptr<Canal> c = canal_de("recibir", args[0]);
+    Mensaje m;
+    if (!c->recibir(m)) return 0.0;
+    string destino = trim(args[1]);
+    if (m.es_texto) set_vt(destino, m.t);
+    else set_vn(destino, m.n);
+    return 1.0;
+}
+
+void cerrar_canal(const vector<string>& args) {
+    if (args.size() != 1) throw ErrorRedSync("cerrar: se esperaba cerrar(canal)");
+    canal_de("cerrar", args[0])->cerrar();
+}
+
+// Cuando un hilo del script aborta con un error, ya no cerrará sus canales:
+// se cierran todos para que las demás etapas del pipeline no esperen para
+// siempre. El error se informa al esperar a ese hilo (o al final del script).
+void cerrar_todos_los_canales() {
+    lock_guard<mutex> lk(mutex_canales);
+    for (auto& c : canales) c.second->cerrar();
+}
+
+// Si la ejecución se aborta, el error se queda con la línea de la instrucción
+// más interna que lo provocó.
+ValorRetorno ejecutar_bloque(int pc_start, int pc_end) {
+    int pc = pc_start;
+    try {
+        return ejecutar_desde(pc, pc_end);
+    } catch (ErrorRedSync& e) {
+        if (e.linea == 0 && pc >= 0 && pc < (int)lineas_origen.size()) e.linea = lineas_origen[pc];
+        throw;
+    }
+}
+
+// Valor de un operando decodificado. false si el nombre no es una vn (la
+// línea va entonces por el camino general). Con 'como_condicion' se aplica la
+// regla de evaluar_comparacion: si el nombre es de texto, la comparación es de
+// texto.
+inline bool leer_operando(const Operando& o, double& v, bool como_condicion) {
+    if (o.literal) { v = o.valor; return true; }
+    const double* p = como_condicion ? vn_visible(o.nombre, false) : buscar_vn(o.nombre);
+    if (!p) return false;
+    v = *p;
+    return true;
+}
+
+inline bool comparar(char op, double a, double b) {
+    switch (op) {
+        case '<': return a < b;
+        case '>': return a > b;
+        case 'l': return a <= b;
+        case 'g': return a >= b;
+        case '=': return abs(a - b) < 1e-5;
+        default:  return abs(a - b) > 1e-5;
+    }
+}
+
+// Con GCC y Clang cada operación salta directamente a la siguiente (goto
+// calculado); con otros compiladores, o definiendo REDSYNC_SIN_GOTO_CALCULADO,
+// se vuelve al switch del principio del bucle.
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(REDSYNC_SIN_GOTO_CALCULADO)
+#define REDSYNC_GOTO_CALCULADO
+#endif
+
+ValorRetorno ejecutar_desde(int& pc, int pc_end) {
+    ValorRetorno retorno;
+    int limit = (pc_end == -1) ? (int)script.size() : pc_end;
+    AsignacionElemento elemento;
+    const Instruccion* cod = instrucciones.data();
+    // --frecuencia-ops, --traza y --muestreo: una sola comprobación por operación si no hay ninguno
+    const bool anotar = frecuencia_ops && pila_padre == nullptr && !en_tarea;
+    const bool trazar = Traza::activa();
+    const bool muestrear = Muestreo::activo() && pila_padre == nullptr && !en_tarea;
+    const bool observar = anotar || trazar || muestrear;
+    auto observar_operacion = [&](int pc_op) {
+        if (anotar) Instrucciones::anotar(cod[pc_op].op);
+        if (trazar) Traza::pc_actual() = pc_op;
+        if (muestrear) Muestreo::publicar(pc_op);
+    };
+
+#ifdef REDSYNC_GOTO_CALCULADO
+    // Mismo orden que el enum Operacion
+    static const void* const destinos[NUM_OPERACIONES] = {
+        &&op_generica, &&op_si, &&op_si, &&op_si_compara, &&op_si_compara, &&op_sino, &&op_fin_si,
+        &&op_fin_mientras, &&op_contar, &&op_fin_contar, &&op_funcion, &&op_fin_funcion,
+        &&op_asigna_aritmetica, &&op_generica, &&op_generica, &&op_generica, &&op_generica,
+        &&op_generica, &&op_generica, &&op_generica, &&op_generica, &&op_cada_entrada, &&op_fin_mientras
+    };
+#define DESPACHAR() do { \
+        if (pc >= limit) goto fin_bloque; \
+        Limites::paso(); \
+        if (observar) observar_operacion(pc); \
+        goto *destinos[cod[pc].op]; \
+    } while (0)
+#else
+#define DESPACHAR() continue
+#endif
+
+    while (pc < limit) {
+#ifdef REDSYNC_GOTO_CALCULADO
+        DESPACHAR();
+#else
+        Limites::paso();
+        if (observar) observar_operacion(pc);
+        switch (cod[pc].op) {
+            case OP_SI: case OP_MIENTRAS: goto op_si;
+            case OP_SI_COMPARA: case OP_MIENTRAS_COMPARA: goto op_si_compara;
+            case OP_SINO: goto op_sino;
+            case OP_FIN_SI: goto op_fin_si;
+            case OP_FIN_MIENTRAS: goto op_fin_mientras;
+            case OP_CONTAR: goto op_contar;
+            case OP_FIN_CONTAR: goto op_fin_contar;
+            case OP_FUNCION: goto op_funcion;
+            case OP_FIN_FUNCION: goto op_fin_funcion;
+            case OP_ASIGNA_ARITMETICA: goto op_asigna_aritmetica;
+            case OP_CADA_ENTRADA: goto op_cada_entrada;
+            case OP_FIN_CADA_ENTRADA: goto op_fin_mientras;
+            default: goto op_generica;
+        }
+#endif
+
+    op_si: {
+        const Instruccion& in = cod[pc];
+        pc = evaluar_condicion_maestra(in.texto) ? pc + 1 : in.destino;
+        DESPACHAR();
+    }
+    op_si_compara: {
+        const Instruccion& in = cod[pc];
+        double a, b;
+        bool cumple = (leer_operando(in.a, a, true) && leer_operando(in.b, b, false))
+                      ? comparar(in.operador, a, b) : evaluar_condicion_maestra(in.texto);
+        pc = cumple ? pc + 1 : in.destino;
+        DESPACHAR();
+    }
+    op_sino: {
+        pc = cod[pc].destino;
+        DESPACHAR();
+    }
+    op_fin_si: {
+        pc++;
+        DESPACHAR();
+    }
+    op_fin_mientras: {
+        pc = cod[pc].destino; // vuelve a la condición (o a la cabecera de cada_entrada)
+        DESPACHAR();
+    }
+    op_cada_entrada: {
+        const Instruccion& in = cod[pc];
+        pc = paso_cada_entrada(pc, in.nombre, in.texto) ? pc + 1 : in.destino;
+        DESPACHAR();
+    }
+    op_contar: {
+        const Instruccion& in = cod[pc];
+        if (!pila_memoria.back().contadores_bucle.count(pc)) {
+            set_vn(in.nombre, evaluar_matematica(in.texto), true);
+            pila_memoria.back().contadores_bucle[pc] = 1;
+        }
+        double fin;
+        if (!leer_operando(in.b, fin, false)) fin = evaluar_matematica(in.texto2);
+        if (get_vn(in.nombre) > fin) {
+            pila_memoria.back().contadores_bucle.erase(pc);
+            pc = in.destino;
+        }
+        else pc++;
+        DESPACHAR();
+    }
+    op_fin_contar: {
+        // Incremento, comparación y vuelta al cuerpo en un solo paso
+        const Instruccion& in = cod[pc];
+        Contexto& marco = pila_memoria.back();
+        auto v = marco.vn.find(in.nombre);
+        if (v == marco.vn.end()) goto op_generica;
+        v->second += 1;
+        double fin;
+        if (!leer_operando(in.b, fin, false)) pc = in.destino; // el límite es una expresión: lo evalúa contar
+        else if (v->second > fin) {
+            marco.contadores_bucle.erase(in.destino);
+            pc = in.destino2;
+        }
+        else pc = in.destino + 1;
+        DESPACHAR();
+    }
+    op_funcion: {
+        pc = cod[pc].destino; // la definición se salta entera
+        DESPACHAR();
+    }
+    op_fin_funcion: {
+        // Solo se llega aquí desde dentro de la función (la definición se
+        // salta entera): sin 'retornar' explícito la función termina aquí.
+        return retorno;
+    }
+    op_asigna_aritmetica: {
+        const Instruccion& in = cod[pc];
+        double a, b = 0.0, r;
+        if (!leer_operando(in.a, a, false) || (in.operador && !leer_operando(in.b, b, false))) goto op_generica;
+        switch (in.operador) {
+            case '+': r = a + b; break;
+            case '-': r = a - b; break;
+            case '*': r = a * b; break;
+            default:  r = a; break;
+        }
+        if (in.declara) pila_memoria.back().vn[in.nombre] = r;
+        else if (double* destino = vn_visible(in.nombre, true)) *destino = r;
+        else goto op_generica;
+        pc++;
+        DESPACHAR();
+    }
+
+    op_generica: {
+        string instr = script[pc];
+        stringstream ss(instr);
+        string cmd; ss >> cmd;
+        string raw_cmd = cmd; 
+        if (cmd.find('(') != string::npos) cmd = cmd.substr(0, cmd.find('('));
+
+        if (cmd == "si" || cmd == "mientras") {
+            size_t p1 = instr.find('(');
+            size_t p2 = instr.find_last_of(')');
+            string cond = (p1 != string::npos && p2 != string::npos) ? instr.substr(p1+1, p2-p1-1) : "";
+            if (!evaluar_condicion_maestra(cond)) { pc = saltos[pc]; continue; }
+        }
+        else if (cmd == "sino") { pc = saltos[pc]; continue; }
+        else if (cmd == "si!") { /* pass */ }
+        else if (cmd == "funcion!") {
+            // Solo se llega aquí desde dentro de la función (la definición se
+            // salta entera): sin 'retornar' explícito la función termina aquí.
+            return retorno;
+        }
+        else if (cmd == "mientras!") { pc = saltos[pc] - 1; }
+        
+        else if (cmd == "cada") {
+            size_t p1 = instr.find('(');
+            size_t p2 = instr.find_last_of(')');
+            if (p1 != string::npos && p2 != string::npos) {
+                string contenido = instr.substr(p1+1, p2-p1-1);
+                stringstream ss_c(contenido);
                 string var_iter, en_kw, nombre_lista;
-                ss_c >> var_iter >> en_kw >> nombre_lista;
+                ss_c >> var_iter >> en_kw;
+                getline(ss_c, nombre_lista); // rango(0, 10) lleva espacios
                 
                 var_iter = trim(var_iter);
                 nombre_lista = trim(nombre_lista);
 
-                vector<double>* ln_ptr = get_ln_ptr(nombre_lista);
-                vector<string>* lt_ptr = get_lt_ptr(nombre_lista);
-                int sz = 0;
-                if (ln_ptr) sz = (int)ln_ptr->size();
-                else if (lt_ptr) sz = (int)lt_ptr->size();
-
-                if (!pila_memoria.back().contadores_bucle.count(pc)) {
-                    pila_memoria.back().contadores_bucle[pc] = 0;
+                if (nombre_lista == "entrada_lineas" || nombre_lista.rfind("entrada_csv", 0) == 0) {
+                    if (!paso_cada_entrada(pc, var_iter, nombre_lista)) {
+                        pc = saltos[pc];
+                        continue;
+                    }
                 }
+                // rango(...) y lista[a:b]: límites calculados una vez al entrar
+                else if (nombre_lista.find('(') != string::npos || nombre_lista.find('[') != string::npos) {
+                    if (!paso_cada_vista(pc, var_iter, nombre_lista)) {
+                        pc = saltos[pc];
+                        continue;
+                    }
+                }
+                else {
+                    vector<double>* ln_ptr = get_ln_ptr(nombre_lista);
+                    vector<string>* lt_ptr = get_lt_ptr(nombre_lista);
+                    MapaHash* mp_ptr = (ln_ptr || lt_ptr) ? nullptr : get_mp_ptr(nombre_lista);
+                    int sz = 0;
+                    if (ln_ptr) sz = (int)ln_ptr->size();
+                    else if (lt_ptr) sz = (int)lt_ptr->size();
+                    else if (mp_ptr) sz = (int)mp_ptr->capacidad();
+
+                    if (!pila_memoria.back().contadores_bucle.count(pc)) {
+                        pila_memoria.back().contadores_bucle[pc] = 0;
+                    }
 
-                int idx = pila_memoria.back().contadores_bucle[pc];
+                    int idx = pila_memoria.back().contadores_bucle[pc];
+                    // En un mapa el contador es la celda: se salta a la siguiente ocupada
+                    if (mp_ptr && idx < sz) {
+                        idx = (int)mp_ptr->siguiente((size_t)idx);
+                        pila_memoria.back().contadores_bucle[pc] = idx;
+                    }
 
-                if (idx < sz) {
-                    if (ln_ptr) set_vn(var_iter, (*ln_ptr)[idx], true);
-                    else if (lt_ptr) set_vt(var_iter, (*lt_ptr)[idx], true);
-                } else {
-                    pila_memoria.back().contadores_bucle.erase(pc);
-                    pc = saltos[pc];
-                    continue;
+                    if (idx < sz) {
+                        if (ln_ptr) set_vn(var_iter, (*ln_ptr)[idx], true);
+                        else if (lt_ptr) set_vt(var_iter, (*lt_ptr)[idx], true);
+                        else if (mp_ptr) set_vt(var_iter, mp_ptr->celda(idx).clave, true);
+                    } else {
+                        pila_memoria.back().contadores_bucle.erase(pc);
+                        pc = saltos[pc];
+                        continue;
+                    }
                 }
             }
         }
+        else if (cmd == "cada_paralelo") {
+            ejecutar_cada_paralelo(pc);
+            pc = saltos[pc];
+            continue;
+        }
         else if (cmd == "cada!") {
             int ini_pc = saltos[pc];
             if (pila_memoria.back().contadores_bucle.count(ini_pc)) {
@@ -647,20 +2874,55 @@ ValorRetorno ejecutar_bloque(int pc_start, int pc_end) {
         }
 
         else if (cmd == "funcion") {
-            pc = saltos[pc]; 
+            pc = saltos[pc] + 1; 
             continue; 
         }
         else if (cmd == "retornar") {
             string expr_ret = trim(instr.substr(8)); 
             if (expr_ret.empty()) expr_ret = "0";
+
+            // Llamada en cola (retornar f(...)): el frame actual se reutiliza
+            // para f y se salta a su cuerpo sin anidar otra llamada nativa, así
+            // que la recursión en cola no gasta pila ni profundidad.
+            string nombre_cola, args_cola;
+            if (pc_end == -1 && pila_memoria.size() > 1 && es_llamada_funcion(expr_ret, nombre_cola, args_cola)) {
+                auto it_cola = funciones.find(nombre_cola);
+                const InfoFuncion& info = it_cola->second;
+                vector<string> args = split_smart(args_cola, ',');
+                if (args.size() == 1 && trim(args[0]).empty()) args.clear();
+                Contexto nuevo_frame;
+                nuevo_frame.funcion = &it_cola->first;
+                preparar_marco(info, args, nuevo_frame, true);
+                pila_memoria.back() = move(nuevo_frame);
+                if (Muestreo::activo() && pila_padre == nullptr && !en_tarea) Muestreo::reemplazar(&it_cola->first);
+                pc = info.linea_inicio;
+                continue;
+            }
+
+            // Una lista local de la función se entrega tal cual (se mueve, el
+            // frame va a desaparecer); una lista ajena se copia.
+            RefLista ref_ret;
+            if (es_nombre_simple(expr_ret) && localizar_lista(expr_ret, ref_ret) &&
+                (get_ln_ptr(expr_ret) || get_lt_ptr(expr_ret))) {
+                Contexto& marco = pila_memoria.back();
+                bool propia = pila_memoria.size() > 1;
+                if (vector<double>* ln_ptr = get_ln_ptr(expr_ret)) {
+                    auto local = marco.ln.find(expr_ret);
+                    retorno.ln = (propia && local != marco.ln.end()) ? move(local->second) : *ln_ptr;
+                    retorno.lista = 'n';
+                } else {
+                    vector<string>* lt_ptr = get_lt_ptr(expr_ret);
+                    auto local = marco.lt.find(expr_ret);
+                    retorno.lt = (propia && local != marco.lt.end()) ? move(local->second) : *lt_ptr;
+                    retorno.lista = 't';
+                }
+                retorno.activo = true;
+                return retorno;
+            }
             
             bool parece_texto = false;
             if (expr_ret.front() == '"') parece_texto = true;
-            else if (!get_vt(expr_ret).empty()) parece_texto = true;
-            else {
-                for(auto it = pila_memoria.rbegin(); it != pila_memoria.rend(); ++it) 
-                    if(it->vt.count(expr_ret)) parece_texto = true;
-            }
+            else if (es_texto_visible(expr_ret)) parece_texto = true;
 
             if (!parece_texto && expr_ret.find('"') != string::npos && expr_ret.find('+') != string::npos) {
                 parece_texto = true;
@@ -677,6 +2939,9 @@ ValorRetorno ejecutar_bloque(int pc_start, int pc_end) {
             return retorno; 
         }
 
+        else if (cmd == "tarea") sentencia_tarea(instr);
+        else if (cmd == "hilo") sentencia_hilo(instr);
+        else if (cmd == "canal") sentencia_canal(instr);
         else if (cmd == "importar") {
             size_t p1 = instr.find('(');
             size_t p2 = instr.find_last_of(')');
@@ -685,7 +2950,10 @@ ValorRetorno ejecutar_bloque(int pc_start, int pc_end) {
                 cargar_modulo_externo(mod_nombre);
             }
         }
+        else if (ejecutar_comando_modulo(pc, cmd, instr)) {}
         else if (modulos_registrados.count(cmd)) {
+            // API v1: el módulo recibe el texto crudo de los argumentos
+            Traza::Tramo tramo(Traza::MODULO, cmd);
             string args_mod = "";
             size_t p1 = instr.find('(');
             size_t p2 = instr.find_last_of(')');
@@ -694,12 +2962,34 @@ ValorRetorno ejecutar_bloque(int pc_start, int pc_end) {
             }
             modulos_registrados[cmd](args_mod);
         }
+        else if (funciones.count(cmd) && instr.find('(') != string::npos && instr.find('=') == string::npos) {
+            // Llamada suelta: duplicar(datos). El valor retornado se descarta.
+            size_t p1 = instr.find('(');
+            size_t p2 = instr.find_last_of(')');
+            vector<string> args;
+            if (p2 != string::npos && p2 > p1) args = split_smart(instr.substr(p1+1, p2-p1-1), ',');
+            if (args.size() == 1 && trim(args[0]).empty()) args.clear();
+            invocar_funcion_generica(cmd, args);
+        }
+        else if (cmd == "esperar" || cmd == "esperar_todas" || cmd == "enviar" || cmd == "recibir" || cmd == "cerrar") {
+            size_t p1 = instr.find('(');
+            size_t p2 = instr.find_last_of(')');
+            vector<string> args;
+            if (p1 != string::npos && p2 != string::npos && p2 > p1) args = split_smart(instr.substr(p1+1, p2-p1-1), ',');
+            if (args.size() == 1 && trim(args[0]).empty()) args.clear();
+            if (cmd == "esperar") esperar_sentencia(args);
+            else if (cmd == "esperar_todas") esperar_todas(args);
+            else if (cmd == "enviar") enviar_a_canal(args);
+            else if (cmd == "recibir") recibir_de_canal(args);
+            else cerrar_canal(args);
+        }
 
         else if (cmd == "mostrar") {
             size_t p1 = instr.find('(');
             size_t p2 = instr.find_last_of(')');
             string contenido = instr.substr(p1+1, p2-p1-1);
-            cout << obtener_texto(contenido) << endl; 
+            string texto = obtener_texto(contenido);
+            emitir_salida(texto + "\n");
         }
 
         else if (cmd == "ln" || cmd == "lt") {
@@ -708,7 +2998,18 @@ ValorRetorno ejecutar_bloque(int pc_start, int pc_end) {
             getline(ss, val);
             val = trim(val);
             size_t b1 = val.find('['), b2 = val.find(']');
-            if (b1 != string::npos && b2 != string::npos) {
+            string error;
+            if (!val.empty() && val.front() != '[' && asignar_lista_retornada(val, nombre, true, error)) {
+                if (!error.empty()) emitir_salida("[ERROR] Lista '" + nombre + "': " + error + "\n");
+            }
+            else if (cmd == "ln" && !val.empty() && val.front() != '[') {
+                if (!evaluar_vectorial(val, nombre, true, error)) emitir_salida("[ERROR] Lista '" + nombre + "': " + error + "\n");
+            }
+            else if (cmd == "lt" && !val.empty() && val.front() != '[') {
+                VistaTexto vista;
+                if (vista_texto(val, vista)) pila_memoria.back().lt[nombre] = vector<string>(vista.datos, vista.datos + vista.n);
+            }
+            else if (b1 != string::npos && b2 != string::npos) {
                 string interno = val.substr(b1+1, b2-b1-1);
                 vector<string> partes = split_smart(interno, ',');
                 if (cmd == "ln") {
@@ -722,6 +3023,17 @@ ValorRetorno ejecutar_bloque(int pc_start, int pc_end) {
                 }
             }
         }
+        else if (cmd == "mapa") {
+            string nombre, resto;
+            ss >> nombre;
+            getline(ss, resto);
+            size_t eq = nombre.find('=');
+            if (eq != string::npos) { resto = nombre.substr(eq) + resto; nombre = nombre.substr(0, eq); }
+            declarar_mapa(nombre, resto);
+        }
+        else if (raw_cmd.find('[') != string::npos && parsear_asignacion_elemento(instr, elemento)) {
+            ejecutar_asignacion_elemento(elemento, pc);
+        }
         else if (raw_cmd.find('.') != string::npos) {
             size_t dot = raw_cmd.find('.');
             string var = raw_cmd.substr(0, dot);
@@ -734,6 +3046,7 @@ ValorRetorno ejecutar_bloque(int pc_start, int pc_end) {
 
             vector<double>* ln_ptr = get_ln_ptr(var);
             vector<string>* lt_ptr = get_lt_ptr(var);
+            MapaHash* mp_ptr = (ln_ptr || lt_ptr) ? nullptr : get_mp_ptr(var);
 
             if (ln_ptr) {
                 if (metodo == "agregar") ln_ptr->push_back(evaluar_matematica(arg_str));
@@ -741,7 +3054,8 @@ ValorRetorno ejecutar_bloque(int pc_start, int pc_end) {
                     int idx = (int)evaluar_matematica(arg_str);
                     if (idx >= 0 && idx < (int)ln_ptr->size()) ln_ptr->erase(ln_ptr->begin() + idx);
                 }
-                else if (metodo == "ordenar") sort(ln_ptr->begin(), ln_ptr->end());
+                else if (metodo == "ordenar") Ordenamiento::ordenar(*ln_ptr);
+                else if (metodo == "ordenar_por") ordenar_por(var, arg_str, pc);
                 else if (metodo == "invertir") reverse(ln_ptr->begin(), ln_ptr->end());
             } 
             else if (lt_ptr) {
@@ -750,9 +3064,18 @@ ValorRetorno ejecutar_bloque(int pc_start, int pc_end) {
                     int idx = (int)evaluar_matematica(arg_str);
                     if (idx >= 0 && idx < (int)lt_ptr->size()) lt_ptr->erase(lt_ptr->begin() + idx);
                 }
-                else if (metodo == "ordenar") sort(lt_ptr->begin(), lt_ptr->end());
+                else if (metodo == "ordenar") Ordenamiento::ordenar(*lt_ptr);
+                else if (metodo == "ordenar_por") ordenar_por(var, arg_str, pc);
                 else if (metodo == "invertir") reverse(lt_ptr->begin(), lt_ptr->end());
             }
+            else if (mp_ptr) {
+                if (metodo == "poner") {
+                    vector<string> args = split_smart(arg_str, ',');
+                    if (args.size() >= 2) mp_ptr->poner(obtener_texto(args[0]), evaluar_valor_mapa(args[1]));
+                }
+                else if (metodo == "eliminar") mp_ptr->eliminar(obtener_texto(arg_str));
+                else if (metodo == "limpiar") mp_ptr->limpiar();
+            }
         }
 
         else if (instr.find('=') != string::npos && instr.find("==") == string::npos) {
@@ -770,23 +3093,35 @@ ValorRetorno ejecutar_bloque(int pc_start, int pc_end) {
                 size_t p1 = rhs_full.find('(');
                 size_t p2 = rhs_full.find_last_of(')');
                 if (p1 != string::npos && p2 != string::npos) {
+                    // Leyendo de una tubería o un archivo el mensaje no se muestra
                     string msg = rhs_full.substr(p1+1, p2-p1-1);
-                    cout << obtener_texto(msg); 
+                    if (origen_entrada || LectorEntrada::interactiva()) emitir_salida(obtener_texto(msg));
                     string input_usr;
-                    getline(cin, input_usr);
+                    leer_entrada(input_usr);
                     if (es_nueva_vn || pila_memoria.back().vn.count(nombre_var)) {
-                        try { set_vn(nombre_var, stod(input_usr), es_nueva_vn); } catch(...) { set_vn(nombre_var, 0, es_nueva_vn); }
+                        set_vn(nombre_var, LectorEntrada::a_numero(input_usr), es_nueva_vn);
                     } else {
                         set_vt(nombre_var, input_usr, es_nueva_vt);
                     }
                 }
             } 
+            else if (!es_nueva_vn && !es_nueva_vt && !buscar_vn(nombre_var) && !buscar_vt(nombre_var) &&
+                     (get_ln_ptr(nombre_var) || get_lt_ptr(nombre_var))) {
+                string error;
+                if (!asignar_lista_retornada(rhs_full, nombre_var, false, error)) {
+                    if (get_ln_ptr(nombre_var)) evaluar_vectorial(rhs_full, nombre_var, false, error);
+                    else error = "a una lista de texto solo se le puede asignar una funcion que retorne una lista";
+                }
+                if (!error.empty()) emitir_salida("[ERROR] Lista '" + nombre_var + "': " + error + "\n");
+            }
             else {
+                // Unas comillas solo dentro de una llamada (m.obtener("pan") * 2) no
+                // convierten en texto una variable declarada o ya existente como vn
                 bool es_texto = false;
-                if (es_nueva_vt || rhs_full.find('"') != string::npos) es_texto = true;
-                else {
-                    for(auto it = pila_memoria.rbegin(); it != pila_memoria.rend(); ++it) if(it->vt.count(nombre_var)) es_texto = true;
-                }
+                if (es_nueva_vt) es_texto = true;
+                else if (rhs_full.find('"') != string::npos)
+                    es_texto = !((es_nueva_vn || buscar_vn(nombre_var)) && !comillas_fuera_de_llamadas(rhs_full));
+                else if (!es_nueva_vn && es_texto_visible(nombre_var)) es_texto = true;
 
                 if (es_texto) {
                     set_vt(nombre_var, obtener_texto(rhs_full), es_nueva_vt);
@@ -799,6 +3134,11 @@ ValorRetorno ejecutar_bloque(int pc_start, int pc_end) {
         
         pc++;
     }
+    }
+#ifdef REDSYNC_GOTO_CALCULADO
+fin_bloque:
+#endif
+#undef DESPACHAR
     return retorno;
 }
 
@@ -842,45 +3182,32 @@ void cargar_puente_web() {
     }
 }
 
-//MAIN
-
-int main(int argc, char* argv[]) {
-    #ifdef _WIN32
-    SetConsoleOutputCP(65001); 
-    #endif
-
-    string arch = ""; 
-    bool modo_web = false;
-
-    // Analizar argumentos
-    for (int i = 1; i < argc; i++) {
-        string argumento = argv[i];
-        if (argumento == "--web") {
-            modo_web = true; 
-        } 
-        else if (arch == "") { 
-            arch = argumento;
-        }
-    }
-
-    if (arch == "") arch = "script.red";
-
-    ifstream f(arch);
-    if (!f.is_open()) {
-        cout << "Error: No se pudo abrir '" << arch << "'" << endl;
-        return 1;
-    }
+// --- CARGA Y COMPILACIÓN ---
 
+// Quita comentarios y líneas vacías; cada instrucción recuerda su línea real
+void leer_fuente(istream& fuente) {
+    script.clear();
+    lineas_origen.clear();
     string lin;
-    while (getline(f, lin)) {
+    int num_linea = 0;
+    while (getline(fuente, lin)) {
+        num_linea++;
         size_t p = lin.find("//");
         if (p != string::npos) lin = lin.substr(0, p);
         lin = trim(lin);
-        if (!lin.empty()) script.push_back(lin);
+        if (!lin.empty()) {
+            script.push_back(lin);
+            lineas_origen.push_back(num_linea);
+        }
     }
-    f.close();
+}
 
+// Pre-pase: tabla de saltos de los bloques y tabla de funciones
+bool construir_saltos(string& error) {
+    saltos.clear();
+    funciones.clear();
     stack<int> p_si, p_b, p_func;
+    vector<pair<int, int>> paralelos; // se revisan al final: pueden llamar a funciones declaradas después
     
     for (int i = 0; i < (int)script.size(); i++) {
         string raw = script[i];
@@ -902,12 +3229,13 @@ int main(int argc, char* argv[]) {
                 saltos[origen] = i; 
             }
         }
-        else if (cmd == "mientras" || cmd == "contar" || cmd == "cada") p_b.push(i);
-        else if (cmd == "mientras!" || cmd == "contar!" || cmd == "cada!") {
+        else if (cmd == "mientras" || cmd == "contar" || cmd == "cada" || cmd == "cada_paralelo") p_b.push(i);
+        else if (cmd == "mientras!" || cmd == "contar!" || cmd == "cada!" || cmd == "cada_paralelo!") {
             if (!p_b.empty()) {
                 int ini = p_b.top(); p_b.pop();
                 saltos[i] = ini;
                 saltos[ini] = i + 1;
+                if (cmd == "cada_paralelo!") paralelos.push_back({ini, i});
             }
         }
         else if (cmd == "funcion") {
@@ -917,8 +3245,10 @@ int main(int argc, char* argv[]) {
             if (p1 != string::npos && p2 != string::npos) {
                 string parte_nombre = raw.substr(0, p1);
                 stringstream ss_n(parte_nombre);
-                string f_tag, f_name;
+                string f_tag, f_name, tras_pura;
                 ss_n >> f_tag >> f_name; 
+                bool pura = f_name == "pura" && (ss_n >> tras_pura); // "funcion pura(x)" se llama pura
+                if (pura) f_name = tras_pura;
 
                 string params_raw = raw.substr(p1+1, p2-p1-1);
                 vector<string> p_list;
@@ -932,7 +3262,7 @@ int main(int argc, char* argv[]) {
                         else p_list.push_back(tipo); 
                     }
                 }
-                funciones[f_name] = {i + 1, p_list};
+                funciones[f_name] = {i + 1, p_list, pura};
             }
         }
         else if (cmd == "funcion!") {
@@ -942,6 +3272,244 @@ int main(int argc, char* argv[]) {
             }
         }
     }
+    for (const auto& f : funciones) {
+        if (!f.second.pura) continue;
+        string error_pura = validar_funcion_pura(f.first, f.second);
+        if (!error_pura.empty()) {
+            error = "Linea " + to_string(lineas_origen[f.second.linea_inicio - 1]) + ": " + error_pura;
+            return false;
+        }
+    }
+    for (const auto& cp : paralelos) {
+        string error_cp = validar_cada_paralelo(cp.first, cp.second);
+        if (!error_cp.empty()) {
+            error = "Linea " + to_string(lineas_origen[cp.first]) + ": " + error_cp;
+            return false;
+        }
+    }
+    return true;
+}
+
+void intercambiar_programa(ProgramaCompilado& prog) {
+    script.swap(prog.script);
+    lineas_origen.swap(prog.lineas_origen);
+    saltos.swap(prog.saltos);
+    funciones.swap(prog.funciones);
+    enlaces_modulo.assign(script.size(), EnlaceModulo());
+    programa_enlaces++;
+    Instrucciones::decodificar();
+}
+
+bool compilar_programa(istream& fuente, ProgramaCompilado& prog, string& error) {
+    intercambiar_programa(prog);
+    leer_fuente(fuente);
+    bool ok = construir_saltos(error);
+    if (ok && Optimizador::optimizar(nivel_optimizacion)) ok = construir_saltos(error);
+    intercambiar_programa(prog);
+    return ok;
+}
+
+// El script corre en un hilo cuya pila se reserva a la medida de
+// profundidad_maxima (ver HiloEjecucion.hpp). Los frames que haya preparado
+// quien llama (el global con sus entradas) viajan con él y vuelven al final.
+int ejecutar_programa() {
+    vector<Contexto> frames;
+    frames.swap(pila_memoria);
+    memos.clear();
+    canales.clear();
+    Memoria::reiniciar();
+    int estado = 0;
+    HiloEjecucion::ejecutar(bytes_pila_script(), [&]() {
+        pila_memoria.swap(frames);
+        Limites::iniciar();
+        try {
+            ejecutar_bloque(0);
+            esperar_pendientes(nullptr); // las tareas que el script no esperó
+        } catch (const ErrorRedSync& e) {
+            emitir_salida("[ERROR] Linea " + to_string(e.linea) + ": " + e.what() + "\n");
+            estado = 1;
+            cerrar_todos_los_canales();
+        }
+        try { esperar_pendientes(nullptr); } catch (...) {} // tras un error, sin informar
+        pila_memoria.swap(frames);
+    });
+    frames.swap(pila_memoria);
+    return estado;
+}
+
+bool leer_archivo_completo(const string& ruta, string& contenido) {
+    ifstream f(ruta, ios::binary);
+    if (!f.is_open()) return false;
+    stringstream ss;
+    ss << f.rdbuf();
+    contenido = ss.str();
+    return true;
+}
+
+//MAIN
+#ifndef REDCORE_BIBLIOTECA
+
+// El ejecutable reserva toda su memoria a través de aquí para que --memoria
+// pueda contarla (ver Memoria.hpp). La biblioteca no sustituye el operator new
+// del programa que la usa.
+void* operator new(size_t n) {
+    void* p = malloc(n ? n : 1);
+    if (!p) throw bad_alloc();
+    if (Memoria::contando()) Memoria::anotar_reserva(p);
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    if (Memoria::contando()) Memoria::anotar_liberacion(p);
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+int main(int argc, char* argv[]) {
+    #ifdef _WIN32
+    SetConsoleOutputCP(65001); 
+    #endif
+
+    string arch = ""; 
+    bool modo_web = false;
+    bool modo_servidor = false;
+    bool modo_compilar = false;
+    bool guardar_redc = false;
+    vector<string> archivos_compilar;
+    size_t capacidad_cache = 32;
+    bool estadisticas_memo = false;
+    string ruta_traza;
+    size_t eventos_traza = Traza::EVENTOS_POR_DEFECTO;
+    int hz_muestreo = 0;
+    string ruta_muestreo = "muestreo.folded";
+
+    // Analizar argumentos
+    for (int i = 1; i < argc; i++) {
+        string argumento = argv[i];
+        if (argumento == "--web") {
+            modo_web = true; 
+        } 
+        else if (argumento == "--servidor") {
+            modo_servidor = true;
+        }
+        else if (argumento.rfind("--cache=", 0) == 0) {
+            capacidad_cache = (size_t)atoi(argumento.c_str() + 8);
+        }
+        else if (argumento.size() == 3 && argumento.rfind("-O", 0) == 0 && argumento[2] >= '0' && argumento[2] <= '2') {
+            nivel_optimizacion = argumento[2] - '0';
+        }
+        else if (argumento.rfind("--profundidad-max=", 0) == 0) {
+            profundidad_maxima = max(1, atoi(argumento.c_str() + 18));
+        }
+        else if (argumento.rfind("--memo=", 0) == 0) {
+            tamano_memo = (size_t)max(0, atoi(argumento.c_str() + 7));
+        }
+        else if (argumento == "--memo-estadisticas") {
+            estadisticas_memo = true;
+        }
+        else if (argumento.rfind("--max-pasos=", 0) == 0) {
+            max_pasos = strtoull(argumento.c_str() + 12, nullptr, 10);
+        }
+        else if (argumento.rfind("--tiempo-max=", 0) == 0) {
+            tiempo_maximo = max(0.0, atof(argumento.c_str() + 13));
+        }
+        else if (argumento.rfind("--memoria-max=", 0) == 0) {
+            memoria_maxima = (size_t)(max(0.0, atof(argumento.c_str() + 14)) * 1024 * 1024);
+        }
+        else if (argumento == "--memoria") {
+            Memoria::contando() = true;
+        }
+        else if (argumento.rfind("--traza=", 0) == 0) {
+            ruta_traza = argumento.substr(8);
+        }
+        else if (argumento == "--traza" && i + 1 < argc) {
+            ruta_traza = argv[++i];
+        }
+        else if (argumento.rfind("--traza-eventos=", 0) == 0) {
+            eventos_traza = (size_t)max(1, atoi(argumento.c_str() + 16));
+        }
+        else if (argumento.rfind("--muestreo=", 0) == 0) {
+            hz_muestreo = atoi(argumento.c_str() + 11);
+        }
+        else if (argumento.rfind("--muestreo-salida=", 0) == 0) {
+            ruta_muestreo = argumento.substr(18);
+        }
+        else if (argumento == "--frecuencia-ops") {
+            frecuencia_ops = true;
+        }
+        else if (argumento.rfind("--modulos=", 0) == 0) {
+            rutas_modulos.push_back(argumento.substr(10));
+        }
+        else if (argumento == "--redc") {
+            guardar_redc = true;
+        }
+        else if (argumento == "--compilar") {
+            modo_compilar = true;
+        }
+        else if (modo_compilar) {
+            archivos_compilar.push_back(argumento);
+        }
+        else if (arch == "") { 
+            arch = argumento;
+        }
+    }
+
+    if (!ruta_traza.empty()) Traza::activar(ruta_traza, eventos_traza);
+    if (modo_servidor) return ModoServidor::ejecutar(capacidad_cache);
+
+    // --compilar a.red b.red ... : solo genera las cachés .redc
+    if (modo_compilar) {
+        int errores = 0;
+        for (const string& ruta : archivos_compilar) {
+            string fuente, error;
+            ProgramaCompilado prog;
+            if (!leer_archivo_completo(ruta, fuente)) {
+                cout << "Error: No se pudo abrir '" << ruta << "'" << endl;
+                errores++;
+                continue;
+            }
+            istringstream entrada_fuente(fuente);
+            if (!compilar_programa(entrada_fuente, prog, error)) {
+                cout << "[ERROR] " << ruta << ": " << error << endl;
+                errores++;
+            }
+            else if (!CacheCompilada::guardar(CacheCompilada::ruta_para(ruta), fuente, prog)) {
+                cout << "Error: No se pudo escribir '" << CacheCompilada::ruta_para(ruta) << "'" << endl;
+                errores++;
+            }
+            else {
+                cout << "Compilado: " << CacheCompilada::ruta_para(ruta) << endl;
+            }
+        }
+        return errores ? 1 : 0;
+    }
+
+    if (arch == "") arch = "script.red";
+
+    string fuente;
+    if (!leer_archivo_completo(arch, fuente)) {
+        cout << "Error: No se pudo abrir '" << arch << "'" << endl;
+        return 1;
+    }
+
+    // Si hay un .redc al día se carga tal cual; si no, se compila el fuente y,
+    // con --redc, se deja el .redc para la próxima vez (si no se puede
+    // escribir, se sigue sin avisar)
+    ProgramaCompilado prog;
+    if (!CacheCompilada::cargar(CacheCompilada::ruta_para(arch), fuente, prog)) {
+        string error;
+        istringstream entrada_fuente(fuente);
+        if (!compilar_programa(entrada_fuente, prog, error)) {
+            cout << "[ERROR] " << error << endl;
+            return 1;
+        }
+        if (guardar_redc) CacheCompilada::guardar(CacheCompilada::ruta_para(arch), fuente, prog);
+    }
+    intercambiar_programa(prog);
 
     pila_memoria.push_back(Contexto());
     
@@ -949,8 +3517,14 @@ int main(int argc, char* argv[]) {
         cargar_puente_web(); 
     }
     
-    ejecutar_bloque(0);
-
-    return 0;
+    if (hz_muestreo > 0) Muestreo::activar(hz_muestreo, ruta_muestreo);
+    int estado = ejecutar_programa();
+    Muestreo::volcar();
+    if (estadisticas_memo) informe_memo(cerr);
+    if (frecuencia_ops) Instrucciones::informe(cerr);
+    if (Memoria::contando()) Memoria::informe(cerr);
+    Traza::volcar();
+    return estado;
 
 }
+#endif